@@ -0,0 +1,122 @@
+#include "AllocationCounter.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+    std::atomic<uint64_t> g_numAllocations{};
+
+    void* Allocate(size_t size) {
+        g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    // For types aligned beyond what operator new guarantees by default
+    void* AllocateAligned(size_t size, std::align_val_t alignment) {
+        g_numAllocations.fetch_add(1, std::memory_order_relaxed);
+        const size_t align = std::max(static_cast<size_t>(alignment), sizeof(void*));
+#ifdef _MSC_VER
+        return _aligned_malloc(size == 0 ? 1 : size, align);
+#else
+        // aligned_alloc wants a size that's a multiple of the alignment
+        return std::aligned_alloc(align, (std::max<size_t>(size, 1) + align - 1) / align * align);
+#endif
+    }
+
+    void FreeAligned(void* p) {
+#ifdef _MSC_VER
+        _aligned_free(p);
+#else
+        std::free(p);
+#endif
+    }
+} // namespace
+
+uint64_t AllocationCounter::Count() {
+    return g_numAllocations.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t size) {
+    if (void* p = Allocate(size))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return Allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = AllocateAligned(size, alignment))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateAligned(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return AllocateAligned(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    FreeAligned(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    FreeAligned(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    FreeAligned(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    FreeAligned(p);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "Base.h"
+
+// Counts heap allocations made through the global operator new (aligned or not), to check that
+// steady-state frames don't allocate. The replacement operators are defined alongside Count(), and
+// replace operator new in any executable that links them in, so AllocationCounter.cpp is left out
+// of vectrexy_core and only built into the GUI and vectrexy_headless. The benchmark and runner keep
+// the default allocator.
+namespace AllocationCounter {
+    // Number of allocations made by all threads since the process started
+    uint64_t Count();
+} // namespace AllocationCounter
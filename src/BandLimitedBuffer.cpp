@@ -0,0 +1,104 @@
+#include "BandLimitedBuffer.h"
+#include "Serializer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    const size_t KernelWidth = BandLimitedBuffer::KernelWidth;
+    const size_t NumPhases = BandLimitedBuffer::NumPhases;
+
+    // Cutoff frequency of the steps' low-pass filter, as a fraction of the output sample rate. Just
+    // below Nyquist, so that the window's transition band mostly stays under it.
+    const double Cutoff = 0.45;
+
+    using Kernel = std::array<float, KernelWidth>;
+
+    // Blackman-windowed sinc, centred on 0
+    double Impulse(double x) {
+        const double Pi = 3.14159265358979323846;
+        const double halfWidth = KernelWidth / 2.0;
+        if (std::abs(x) >= halfWidth)
+            return 0.0;
+        const double t = 2 * Pi * Cutoff * x;
+        const double sinc = t == 0 ? 1.0 : std::sin(t) / t;
+        const double window =
+            0.42 + 0.5 * std::cos(Pi * x / halfWidth) + 0.08 * std::cos(2 * Pi * x / halfWidth);
+        return 2 * Cutoff * sinc * window;
+    }
+
+    // For each phase, the change of level that a step of height 1 starting that far into an output
+    // sample makes at each of the next KernelWidth samples: the impulse integrated over each one.
+    const std::array<Kernel, NumPhases>& Kernels() {
+        static const auto kernels = [] {
+            std::array<Kernel, NumPhases> result{};
+            for (size_t phase = 0; phase < NumPhases; ++phase) {
+                const double offset = static_cast<double>(phase) / NumPhases;
+                std::array<double, KernelWidth> taps{};
+                double sum = 0;
+                for (size_t i = 0; i < KernelWidth; ++i) {
+                    // Simpson's rule
+                    const int NumIntervals = 16;
+                    const double begin = i - offset - KernelWidth / 2.0;
+                    double integral = Impulse(begin) + Impulse(begin + 1);
+                    for (int j = 1; j < NumIntervals; ++j) {
+                        integral += (j % 2 == 0 ? 2 : 4) * Impulse(begin + j / double(NumIntervals));
+                    }
+                    taps[i] = integral / (3 * NumIntervals);
+                    sum += taps[i];
+                }
+                // Make each step reach its full height
+                for (size_t i = 0; i < KernelWidth; ++i) {
+                    result[phase][i] = static_cast<float>(taps[i] / sum);
+                }
+            }
+            return result;
+        }();
+        return kernels;
+    }
+} // namespace
+
+void BandLimitedBuffer::Reset() {
+    *this = {};
+}
+
+void BandLimitedBuffer::SetLevel(float time, float level) {
+    const float delta = level - m_targetLevel;
+    if (delta == 0)
+        return;
+    m_targetLevel = level;
+    m_quietSamples = 0;
+
+    // Round to the nearest phase, which may be the start of the next sample
+    assert(time >= 0 && time < 2);
+    const auto position = static_cast<size_t>(time * NumPhases + 0.5f);
+    const size_t sample = position / NumPhases;
+    const Kernel& kernel = Kernels()[position % NumPhases];
+
+    // Fixed-width multiply-add over contiguous floats, which compilers turn into SIMD instructions
+    float* deltas = &m_deltas[m_index + sample];
+    for (size_t i = 0; i < KernelWidth; ++i) {
+        deltas[i] += kernel[i] * delta;
+    }
+}
+
+float BandLimitedBuffer::ReadSample() {
+    m_level += m_deltas[m_index++];
+
+    // Leave room for a step starting up to 2 samples from now
+    if (m_index + 2 + KernelWidth > BufferSize) {
+        auto unread = std::copy(m_deltas.begin() + m_index, m_deltas.end(), m_deltas.begin());
+        std::fill(unread, m_deltas.end(), 0.f);
+        m_index = 0;
+    }
+
+    // Once the last step has been read in full, drop the rounding errors that built up in the sum
+    if (m_quietSamples < KernelWidth + 2 && ++m_quietSamples == KernelWidth + 2) {
+        m_level = m_targetLevel;
+    }
+
+    return static_cast<float>(m_level);
+}
+
+void BandLimitedBuffer::Serialize(Serializer& s) {
+    s.Serialize(m_deltas, m_index, m_level, m_targetLevel, m_quietSamples);
+}
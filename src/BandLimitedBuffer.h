@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Base.h"
+#include <array>
+
+class Serializer;
+
+// Resamples a signal made of steps (e.g. square waves) to the host rate without aliasing, in the
+// style of blip_buf: instead of averaging the signal over each output sample, every change of level
+// is added as a band-limited step (BLEP), that is a step low-pass filtered below the host Nyquist
+// frequency, starting at the exact time of the change. Reading sums the steps back into the
+// signal, which comes out KernelWidth / 2 samples later than the changes were made.
+class BandLimitedBuffer {
+public:
+    static constexpr size_t KernelWidth = 32; // Output samples each step is spread over
+    static constexpr size_t NumPhases = 64;   // Positions within an output sample a step can start at
+
+    void Reset();
+
+    // Changes the level of the signal at the given time, in output samples since the last one read
+    // (so the next one read is at time 1), which must be less than 2
+    void SetLevel(float time, float level);
+
+    // Returns the next output sample
+    float ReadSample();
+
+    void Serialize(Serializer& s);
+
+private:
+    static constexpr size_t BufferSize = 128;
+
+    // Change of level at each output sample, the next one read being at m_index. Steps are added
+    // to contiguous samples, and the unread ones moved back to the start once there's no more room
+    // after them for a step.
+    std::array<float, BufferSize> m_deltas{};
+    uint32_t m_index{};
+    double m_level{};          // Sum of the deltas read so far
+    float m_targetLevel{};     // Level set by the last call to SetLevel
+    uint32_t m_quietSamples{}; // Samples read since then
+};
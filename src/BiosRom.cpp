@@ -5,6 +5,7 @@
 
 void BiosRom::Init(MemoryBus& memoryBus) {
     memoryBus.ConnectDevice(*this, MemoryMap::Bios.range);
+    memoryBus.MapMemory(MemoryMap::Bios.range, m_data.data(), m_data.size(), false);
 }
 
 void BiosRom::LoadBiosRom(const char* file) {
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <algorithm>
+#include <bitset>
 #include <cstdint>
+#include <iterator>
 #include <map>
 #include <optional>
 
@@ -31,14 +34,23 @@ struct Breakpoint {
     bool autoDelete = false;
 };
 
+// Breakpoints are kept ordered by address, for listing and access by index, along with a bitmap per
+// type of access of the addresses that break, so that checking an address before every instruction
+// or memory access is a single bit test. The bitmaps are rebuilt whenever a breakpoint changes,
+// which is why breakpoints are only modified through this class.
 class Breakpoints {
 public:
-    void Reset() { m_breakpoints.clear(); }
+    void Reset() {
+        m_breakpoints.clear();
+        UpdateBitmaps();
+    }
 
-    Breakpoint* Add(Breakpoint::Type type, uint16_t address) {
+    const Breakpoint* Add(Breakpoint::Type type, uint16_t address, bool autoDelete = false) {
         auto& bp = m_breakpoints[address];
         bp.type = type;
         bp.address = address;
+        bp.autoDelete = autoDelete;
+        UpdateBitmaps();
         return &bp;
     }
 
@@ -47,6 +59,7 @@ public:
         if (iter != m_breakpoints.end()) {
             auto bp = iter->second;
             m_breakpoints.erase(iter);
+            UpdateBitmaps();
             return bp;
         }
         return {};
@@ -57,17 +70,24 @@ public:
         if (iter != m_breakpoints.end()) {
             auto bp = iter->second;
             m_breakpoints.erase(iter);
+            UpdateBitmaps();
             return bp;
         }
         return {};
     }
 
-    Breakpoint* Get(uint16_t address) {
-        // @HACK: Temporary optimization to make debug builds faster when no breakpoints have been
-        // added. Need to make breakpoints generally faster (with or without breakpoints set).
-        if (Num() == 0)
-            return nullptr;
+    // Returns null if index is invalid
+    const Breakpoint* SetEnabledAtIndex(size_t index, bool enabled) {
+        auto iter = GetBreakpointIterAtIndex(index);
+        if (iter != m_breakpoints.end()) {
+            iter->second.enabled = enabled;
+            UpdateBitmaps();
+            return &iter->second;
+        }
+        return nullptr;
+    }
 
+    const Breakpoint* Get(uint16_t address) const {
         auto iter = m_breakpoints.find(address);
         if (iter != m_breakpoints.end()) {
             return &iter->second;
@@ -75,7 +95,7 @@ public:
         return nullptr;
     }
 
-    Breakpoint* GetAtIndex(size_t index) {
+    const Breakpoint* GetAtIndex(size_t index) const {
         auto iter = GetBreakpointIterAtIndex(index);
         if (iter != m_breakpoints.end()) {
             return &iter->second;
@@ -83,7 +103,7 @@ public:
         return nullptr;
     }
 
-    std::optional<size_t> GetIndex(uint16_t address) {
+    std::optional<size_t> GetIndex(uint16_t address) const {
         auto iter = m_breakpoints.find(address);
         if (iter != m_breakpoints.end()) {
             return std::distance(m_breakpoints.begin(), iter);
@@ -93,14 +113,58 @@ public:
 
     size_t Num() const { return m_breakpoints.size(); }
 
+    // Returns true if any Instruction breakpoint can be hit: enabled, or auto-delete, which are hit
+    // regardless
+    bool HasInstructionBreakpoints() const { return m_hasInstructionBreakpoints; }
+
+    // Returns true if any enabled Read, Write or ReadWrite breakpoint (watchpoint) is set
+    bool HasEnabledWatchpoints() const { return m_hasEnabledWatchpoints; }
+
+    // Whether executing the instruction at address, or reading or writing address, should break
+    bool BreaksOnInstruction(uint16_t address) const { return m_instructionBitmap[address]; }
+    bool BreaksOnRead(uint16_t address) const { return m_readBitmap[address]; }
+    bool BreaksOnWrite(uint16_t address) const { return m_writeBitmap[address]; }
+
 private:
+    using Bitmap = std::bitset<0x10000>;
+
+    void UpdateBitmaps() {
+        m_instructionBitmap.reset();
+        m_readBitmap.reset();
+        m_writeBitmap.reset();
+        for (auto& [address, bp] : m_breakpoints) {
+            switch (bp.type) {
+            case Breakpoint::Type::Instruction:
+                m_instructionBitmap[address] = bp.enabled || bp.autoDelete;
+                break;
+            case Breakpoint::Type::Read:
+                m_readBitmap[address] = bp.enabled;
+                break;
+            case Breakpoint::Type::Write:
+                m_writeBitmap[address] = bp.enabled;
+                break;
+            case Breakpoint::Type::ReadWrite:
+                m_readBitmap[address] = bp.enabled;
+                m_writeBitmap[address] = bp.enabled;
+                break;
+            }
+        }
+        m_hasInstructionBreakpoints = m_instructionBitmap.any();
+        m_hasEnabledWatchpoints = m_readBitmap.any() || m_writeBitmap.any();
+    }
+
     std::map<uint16_t, Breakpoint> m_breakpoints;
+    Bitmap m_instructionBitmap;
+    Bitmap m_readBitmap;
+    Bitmap m_writeBitmap;
+    bool m_hasInstructionBreakpoints = false;
+    bool m_hasEnabledWatchpoints = false;
 
-    using IterType = decltype(m_breakpoints.begin());
-    IterType GetBreakpointIterAtIndex(size_t index) {
-        auto iter = m_breakpoints.begin();
-        if (iter != m_breakpoints.end())
-            std::advance(iter, index);
-        return iter;
+    using BreakpointMap = std::map<uint16_t, Breakpoint>;
+    BreakpointMap::iterator GetBreakpointIterAtIndex(size_t index) {
+        return std::next(m_breakpoints.begin(), std::min(index, m_breakpoints.size()));
+    }
+    BreakpointMap::const_iterator GetBreakpointIterAtIndex(size_t index) const {
+        return std::next(m_breakpoints.begin(), std::min(index, m_breakpoints.size()));
     }
 };
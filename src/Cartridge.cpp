@@ -72,19 +72,35 @@ namespace {
 } // namespace
 
 void Cartridge::Init(MemoryBus& memoryBus) {
-    memoryBus.ConnectDevice(*this, MemoryMap::Cartridge.range);
+    m_memoryBus = &memoryBus;
+    m_memoryBus->ConnectDevice(*this, MemoryMap::Cartridge.range);
     m_data.resize(MemoryMap::Cartridge.physicalSize, 0);
+    MapMemory();
 }
 
 bool Cartridge::LoadRom(const char* file) {
     if (IsValidRom(file)) {
         FileStream fs(file, "rb");
         m_data = ReadStreamUntilEnd(fs);
+        MapMemory();
         return true;
     }
     return false;
 }
 
+uint32_t Cartridge::RomHash() const {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (uint8_t value : m_data)
+        hash = (hash ^ value) * 16777619u;
+    return hash;
+}
+
+void Cartridge::MapMemory() {
+    // Any partial page at the end of the rom goes through Read for out of range handling
+    m_memoryBus->MapMemory(MemoryMap::Cartridge.range, m_data.data(), m_data.size(), false);
+}
+
 uint8_t Cartridge::Read(uint16_t address) const {
     auto mappedAddress = MemoryMap::Cartridge.MapAddress(address);
     if (mappedAddress >= m_data.size()) {
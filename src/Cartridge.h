@@ -9,10 +9,17 @@ public:
     void Reset() {}
     bool LoadRom(const char* file);
 
+    // Identifies the loaded rom (e.g. to check a recording is played back with the same one)
+    uint32_t RomHash() const;
+
 private:
     uint8_t Read(uint16_t address) const override;
     void Write(uint16_t address, uint8_t value) override;
 
+    // Maps rom data to memory bus for direct access, must be called whenever m_data changes
+    void MapMemory();
+
 private:
+    MemoryBus* m_memoryBus = nullptr;
     std::vector<uint8_t> m_data;
 };
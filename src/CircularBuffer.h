@@ -100,6 +100,15 @@ public:
     // Returns number of values actually pushed (0 or 1).
     size_t PushBack(const T& value) { return PushBack(&value, 1); }
 
+    // Same as above, but moves value in, so that any storage it owns is handed over to the buffer
+    size_t PushBack(T&& value) {
+        if (Full())
+            return 0;
+        *m_back = std::move(value);
+        IncBack();
+        return 1;
+    }
+
     // Pushes back numValues, removing values from front if full
     void PushBackMoveFront(T* source, size_t numValues) {
         //@TODO: make this more efficient by popping multiple from front
@@ -142,13 +151,13 @@ public:
             assert(m_front <= m_back);
             if (m_front == m_back)
                 return 0;
-            value = *m_front;
+            value = std::move(*m_front);
             IncFront();
             return 1;
         } else // front >= back
         {
             assert(m_front >= m_back);
-            value = *m_front;
+            value = std::move(*m_front);
             IncFront();
             return 1;
         }
@@ -164,12 +173,12 @@ public:
             if (m_back == m_front)
                 return 0;
             DecBack();
-            value = *m_back;
+            value = std::move(*m_back);
             return 1;
         } else { // front >= back
             assert(m_front >= m_back);
             DecBack();
-            value = *m_back;
+            value = std::move(*m_back);
             return 1;
         }
     }
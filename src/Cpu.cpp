@@ -2,10 +2,17 @@
 #include "BitOps.h"
 #include "CpuHelpers.h"
 #include "CpuOpCodes.h"
+#include "CpuProfile.h"
 #include "ErrorHandler.h"
 #include "MemoryBus.h"
+#include "MemoryMap.h"
+#include "Serializer.h"
 #include <array>
+#include <chrono>
+#include <memory>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace {
     template <typename T>
@@ -61,6 +68,39 @@ namespace {
         };
     } // namespace InterruptVector
 
+    // Whether executing the op may jump, or change the interrupt masks, either of which ends a block
+    // (see CpuImpl::ExecuteBlock).
+    constexpr bool EndsBlock(int page, uint8_t opCode) {
+        if (page != 0)
+            return (opCode >= 0x21 && opCode <= 0x2F) || opCode == 0x3F; // Long branches, SWI2/3
+
+        switch (opCode) {
+        case 0x0E: // JMP
+        case 0x6E:
+        case 0x7E:
+        case 0x8D: // BSR
+        case 0x9D: // JSR
+        case 0xAD:
+        case 0xBD:
+        case 0x16: // LBRA
+        case 0x17: // LBSR
+        case 0x39: // RTS
+        case 0x3B: // RTI
+        case 0x3F: // SWI
+        case 0x13: // SYNC
+        case 0x3C: // CWAI
+        case 0x3E: // RESET
+        case 0x1A: // ORCC
+        case 0x1C: // ANDCC
+        case 0x1E: // EXG
+        case 0x1F: // TFR
+        case 0x35: // PULS
+        case 0x37: // PULU
+            return true;
+        }
+        return opCode >= 0x20 && opCode <= 0x2F; // Branches
+    }
+
 } // namespace
 
 class CpuImpl : public CpuRegisters {
@@ -69,6 +109,24 @@ public:
     cycles_t m_cycles{};
     bool m_waitingForInterrupts{}; // Set by CWAI
 
+    using OpHandler = void (CpuImpl::*)();
+
+    // Instructions in ROM never change, so we cache them decoded by address, and execute them
+    // without reading or looking up their op code again. Operand bytes are recorded the first time
+    // the instruction executes, and replayed from the cache by ReadPC8 after that.
+    struct DecodedOp {
+        OpHandler handler{}; // Null until decoded
+        int8_t cycles{};     // Base cycles
+        uint8_t opCodeSize{};
+        uint8_t size{};      // Op code plus operand bytes
+        bool endsBlock{};    // See ExecuteBlock
+        std::array<uint8_t, 4> operands{};
+    };
+    std::vector<DecodedOp> m_decodeCache; // Cartridge then Bios address space
+    const uint8_t* m_replayOperands{};
+    uint8_t* m_recordOperands{};
+    std::unique_ptr<CpuProfile> m_profile; // Null unless profiling
+
     void Init(MemoryBus& memoryBus) { m_memoryBus = &memoryBus; }
 
     void Reset() {
@@ -88,6 +146,10 @@ public:
         m_waitingForInterrupts = false;
     }
 
+    void Serialize(Serializer& s) {
+        s.Serialize(X, Y, U, S, PC, D, DP, CC.Value, m_waitingForInterrupts);
+    }
+
     uint8_t Read8(uint16_t address) { return m_memoryBus->Read(address); }
 
     uint16_t Read16(uint16_t address) {
@@ -97,12 +159,22 @@ public:
         return CombineToU16(high, low);
     }
 
-    uint8_t ReadPC8() { return Read8(PC++); }
-    uint16_t ReadPC16() {
-        uint16_t value = Read16(PC);
-        PC += 2;
+    uint8_t ReadPC8() {
+        if (m_replayOperands) {
+            ++PC;
+            return *m_replayOperands++;
+        }
+        uint8_t value = Read8(PC++);
+        if (m_recordOperands)
+            *m_recordOperands++ = value;
         return value;
     }
+    uint16_t ReadPC16() {
+        // Big endian
+        auto high = ReadPC8();
+        auto low = ReadPC8();
+        return CombineToU16(high, low);
+    }
 
     void Push8(uint16_t& stackPointer, uint8_t value) { m_memoryBus->Write(--stackPointer, value); }
 
@@ -891,76 +963,13 @@ public:
         //@TODO: CC.Entire = 0; ?
     }
 
-    cycles_t ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
-        m_cycles = 0;
-
-        auto UnhandledOp = [this](const CpuOp& cpuOp) {
-            (void)cpuOp;
-            FAIL_MSG("Unhandled Op: %s", cpuOp.name);
-        };
-
-        // Just for debugging, keep a copy in case we assert
-        const auto currInstructionPC = PC;
-        (void)currInstructionPC;
-
-        if (m_waitingForInterrupts) {
-            if (irqEnabled && (CC.InterruptMask == 0)) {
-                m_waitingForInterrupts = false;
-                CC.InterruptMask = 1;
-                PC = Read16(InterruptVector::Irq);
-                return 0; // Already returned CWAI's total cycles the first time we executed it
-
-            } else if (firqEnabled && (CC.FastInterruptMask == 0)) {
-                FAIL_MSG("Implement FIRQ after CWAI");
-                return 0;
-
-            } else {
-                return 0; // No cycles while we wait for an interrupt
-            }
-        }
-
-        if (irqEnabled && (CC.InterruptMask == 0)) {
-            CC.InterruptMask = 1;
-            PushCCState(true);
-            PC = Read16(InterruptVector::Irq);
-            m_cycles += 19;
-            return m_cycles;
-        }
-
-        if (firqEnabled && (CC.FastInterruptMask == 0)) {
-            FAIL_MSG("Implement FIRQ");
-            return 0;
-        }
-
-        // Read op code byte and page
-        int cpuOpPage = 0;
-        uint8_t opCodeByte = ReadPC8();
-        if (IsOpCodePage1(opCodeByte)) {
-            cpuOpPage = 1; //@TODO: 1 cycle (see CpuOpsPage0)
-            opCodeByte = ReadPC8();
-        } else if (IsOpCodePage2(opCodeByte)) {
-            cpuOpPage = 2; //@TODO: 1 cycle (see CpuOpsPage0)
-            opCodeByte = ReadPC8();
-        }
-
-        const CpuOp& cpuOp = LookupCpuOpRuntime(cpuOpPage, opCodeByte);
-
-        ASSERT_MSG(cpuOp.cycles >= 0, "TODO: look at how to handle cycles for instruction: %s",
-                   cpuOp.name);
-        m_cycles += cpuOp.cycles; // Base cycles for this instruction
-
-        if (cpuOp.addrMode == AddressingMode::Illegal) {
-            ErrorHandler::Undefined("Illegal instruction at $%04x, opcode: %02x, page: %d\n",
-                                    currInstructionPC, opCodeByte, cpuOpPage);
-            return m_cycles;
-        }
-
-        ASSERT(cpuOp.addrMode != AddressingMode::Variant &&
-               "Page 1/2 instruction, should have read next byte by now");
-
-        switch (cpuOpPage) {
+    // Instantiated for every page and op code to build OpHandlers; the switches on template
+    // arguments are folded down to the one matching case.
+    template <int page, uint8_t opCode>
+    void ExecuteOp() {
+        switch (page) {
         case 0:
-            switch (cpuOp.opCode) {
+            switch (opCode) {
             case 0x3E:
                 OpRESET();
                 break;
@@ -1686,12 +1695,12 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(page, opCode);
             }
             break;
 
         case 1:
-            switch (cpuOp.opCode) {
+            switch (opCode) {
             case 0x3F:
                 OpSWI(InterruptVector::Swi2);
                 break;
@@ -1815,12 +1824,12 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(page, opCode);
             }
             break;
 
         case 2:
-            switch (cpuOp.opCode) {
+            switch (opCode) {
             case 0x3F:
                 OpSWI(InterruptVector::Swi3);
                 break;
@@ -1852,15 +1861,246 @@ public:
                 break;
 
             default:
-                UnhandledOp(cpuOp);
+                UnhandledOp(page, opCode);
             }
             break;
         }
+    }
+
+    void UnhandledOp(int page, uint8_t opCode) {
+        FAIL_MSG("Unhandled Op: %s", LookupCpuOp(page, opCode).name);
+    }
+
+    template <int page, size_t... opCodes>
+    static constexpr std::array<OpHandler, 256> MakeOpHandlers(std::index_sequence<opCodes...>) {
+        return {&CpuImpl::ExecuteOp<page, static_cast<uint8_t>(opCodes)>...};
+    }
+
+    // ExecuteOp instantiations indexed by page and op code, defined once CpuImpl is complete
+    static const std::array<OpHandler, 256> OpHandlers[3];
+
+    void InvalidateDecodeCache() {
+        m_decodeCache.assign(MemoryMap::Cartridge.physicalSize + MemoryMap::Bios.physicalSize, {});
+    }
+
+    // Returns the decode cache entry for address, or null if address isn't in ROM
+    DecodedOp* FindDecodedOp(uint16_t address) {
+        static_assert(MemoryMap::Cartridge.range.first == 0, "");
+        if (address <= MemoryMap::Cartridge.range.second)
+            return &m_decodeCache[address];
+        if (address >= MemoryMap::Bios.range.first)
+            return &m_decodeCache[MemoryMap::Cartridge.physicalSize +
+                                  (address - MemoryMap::Bios.range.first)];
+        return nullptr;
+    }
+
+    static bool IsInSameRomRegion(uint16_t first, int last) {
+        auto InRegion = [&](const MemoryMap::Mapping& mapping) {
+            return MemoryMap::IsInRange(first, mapping.range) && last <= mapping.range.second;
+        };
+        return InRegion(MemoryMap::Cartridge) || InRegion(MemoryMap::Bios);
+    }
+
+    void ExecuteDecodedOp(const DecodedOp& decodedOp) {
+        PC += decodedOp.opCodeSize;
+        m_cycles += decodedOp.cycles;
+        m_replayOperands = decodedOp.operands.data();
+        (this->*decodedOp.handler)();
+        m_replayOperands = nullptr;
+    }
+
+    // Executes consecutive decoded ops as a block, chaining from one cache entry to the next without
+    // any per-instruction interrupt checks. A block ends after an op that may jump or change the
+    // interrupt masks, before an op that hasn't been decoded yet, or once cycleBudget is used up.
+    // Blocks only run while both interrupt masks are set, so no interrupt can be taken within one.
+    // Profiling is switched on and off by instantiating these with and without it, so that when
+    // off, it only costs a branch per instruction or block
+    int ExecuteBlock(double cycleBudget, cycles_t& elapsedCycles) {
+        return m_profile ? ExecuteBlock<true>(cycleBudget, elapsedCycles)
+                         : ExecuteBlock<false>(cycleBudget, elapsedCycles);
+    }
+
+    cycles_t ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
+        return m_profile ? ExecuteInstruction<true>(irqEnabled, firqEnabled)
+                         : ExecuteInstruction<false>(irqEnabled, firqEnabled);
+    }
+
+    // Runs executeOp, which must leave the op's total cycles in m_cycles, and records it to the
+    // profile if Profiling
+    template <bool Profiling, typename Func>
+    void ProfileOp(int page, uint8_t opCode, Func executeOp) {
+        if constexpr (Profiling) {
+            auto& stats = m_profile->Stats(page, opCode);
+            if (m_profile->Sample()) {
+                const auto startTime = std::chrono::steady_clock::now();
+                executeOp();
+                const auto elapsed = std::chrono::steady_clock::now() - startTime;
+                stats.sampledNanoseconds += static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                ++stats.sampledCount;
+            } else {
+                executeOp();
+            }
+            ++stats.count;
+            stats.cycles += m_cycles;
+        } else {
+            executeOp();
+        }
+    }
+
+    // Decoded ops don't keep their op code, so when profiling, it's read back from ROM
+    template <bool Profiling>
+    void ExecuteDecodedOp(const DecodedOp& decodedOp, uint16_t address) {
+        if constexpr (Profiling) {
+            int page = 0;
+            uint8_t opCode = m_memoryBus->Read(address);
+            if (IsOpCodePage1(opCode) || IsOpCodePage2(opCode)) {
+                page = IsOpCodePage1(opCode) ? 1 : 2;
+                opCode = m_memoryBus->Read(address + 1);
+            }
+            ProfileOp<true>(page, opCode, [&] { ExecuteDecodedOp(decodedOp); });
+        } else {
+            ExecuteDecodedOp(decodedOp);
+        }
+    }
+
+    template <bool Profiling>
+    int ExecuteBlock(double cycleBudget, cycles_t& elapsedCycles) {
+        elapsedCycles = 0;
+
+        if (m_waitingForInterrupts || !CC.InterruptMask || !CC.FastInterruptMask ||
+            m_memoryBus->ReadCallbackActive())
+            return 0;
+
+        int numInstructions = 0;
+        const DecodedOp* decodedOp = FindDecodedOp(PC);
+        while (decodedOp && decodedOp->handler) {
+            m_cycles = 0;
+            ExecuteDecodedOp<Profiling>(*decodedOp, PC);
+            elapsedCycles += m_cycles;
+            ++numInstructions;
+
+            if (decodedOp->endsBlock || elapsedCycles >= cycleBudget)
+                break;
+
+            // Cache entries are laid out by address, so the next op directly follows this one
+            decodedOp += decodedOp->size;
+        }
+        return numInstructions;
+    }
+
+    template <bool Profiling>
+    cycles_t ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
+        m_cycles = 0;
+
+        // In case the previous op was interrupted by an exception
+        m_replayOperands = nullptr;
+        m_recordOperands = nullptr;
+
+        // Just for debugging, keep a copy in case we assert
+        const auto currInstructionPC = PC;
+        (void)currInstructionPC;
+
+        if (m_waitingForInterrupts) {
+            if (irqEnabled && (CC.InterruptMask == 0)) {
+                m_waitingForInterrupts = false;
+                CC.InterruptMask = 1;
+                PC = Read16(InterruptVector::Irq);
+                return 0; // Already returned CWAI's total cycles the first time we executed it
+
+            } else if (firqEnabled && (CC.FastInterruptMask == 0)) {
+                FAIL_MSG("Implement FIRQ after CWAI");
+                return 0;
+
+            } else {
+                return 0; // No cycles while we wait for an interrupt
+            }
+        }
+
+        if (irqEnabled && (CC.InterruptMask == 0)) {
+            CC.InterruptMask = 1;
+            PushCCState(true);
+            PC = Read16(InterruptVector::Irq);
+            m_cycles += 19;
+            return m_cycles;
+        }
+
+        if (firqEnabled && (CC.FastInterruptMask == 0)) {
+            FAIL_MSG("Implement FIRQ");
+            return 0;
+        }
+
+        // Memory bus callbacks (e.g. debugger tracing) must see every read, so bypass the cache
+        DecodedOp* decodedOp =
+            m_memoryBus->ReadCallbackActive() ? nullptr : FindDecodedOp(currInstructionPC);
+
+        if (decodedOp && decodedOp->handler) {
+            ExecuteDecodedOp<Profiling>(*decodedOp, currInstructionPC);
+            return m_cycles;
+        }
+
+        // Read op code byte and page
+        int cpuOpPage = 0;
+        uint8_t opCodeByte = ReadPC8();
+        if (IsOpCodePage1(opCodeByte)) {
+            cpuOpPage = 1; //@TODO: 1 cycle (see CpuOpsPage0)
+            opCodeByte = ReadPC8();
+        } else if (IsOpCodePage2(opCodeByte)) {
+            cpuOpPage = 2; //@TODO: 1 cycle (see CpuOpsPage0)
+            opCodeByte = ReadPC8();
+        }
+
+        const CpuOp& cpuOp = LookupCpuOp(cpuOpPage, opCodeByte);
+
+        ASSERT_MSG(cpuOp.cycles >= 0, "TODO: look at how to handle cycles for instruction: %s",
+                   cpuOp.name);
+        m_cycles += cpuOp.cycles; // Base cycles for this instruction
+
+        if (cpuOp.addrMode == AddressingMode::Illegal) {
+            ErrorHandler::Undefined("Illegal instruction at $%04x, opcode: %02x, page: %d\n",
+                                    currInstructionPC, opCodeByte, cpuOpPage);
+            return m_cycles;
+        }
+
+        ASSERT(cpuOp.addrMode != AddressingMode::Variant &&
+               "Page 1/2 instruction, should have read next byte by now");
+
+        const auto handler = OpHandlers[cpuOpPage][cpuOp.opCode];
+
+        if (!decodedOp) {
+            ProfileOp<Profiling>(cpuOpPage, cpuOp.opCode, [&] { (this->*handler)(); });
+            return m_cycles;
+        }
+
+        const auto opCodeSize = checked_static_cast<uint8_t>(PC - currInstructionPC);
+        m_recordOperands = decodedOp->operands.data();
+        ProfileOp<Profiling>(cpuOpPage, cpuOp.opCode, [&] { (this->*handler)(); });
+        const auto numOperands = m_recordOperands - decodedOp->operands.data();
+        m_recordOperands = nullptr;
+        ASSERT(numOperands <= static_cast<ptrdiff_t>(decodedOp->operands.size()));
+
+        // Only cache instructions that don't straddle the end of the rom region
+        const int lastAddress = currInstructionPC + opCodeSize + static_cast<int>(numOperands) - 1;
+        if (IsInSameRomRegion(currInstructionPC, lastAddress)) {
+            decodedOp->handler = handler;
+            decodedOp->cycles = checked_static_cast<int8_t>(cpuOp.cycles);
+            decodedOp->opCodeSize = opCodeSize;
+            decodedOp->size = checked_static_cast<uint8_t>(opCodeSize + numOperands);
+            // Blocks can't chain past the end of a region, as the next cache entry is for another
+            decodedOp->endsBlock = EndsBlock(cpuOpPage, cpuOp.opCode) ||
+                                   lastAddress == MemoryMap::Cartridge.range.second ||
+                                   lastAddress == MemoryMap::Bios.range.second;
+        }
 
         return m_cycles;
     }
 };
 
+constexpr std::array<CpuImpl::OpHandler, 256> CpuImpl::OpHandlers[3] = {
+    CpuImpl::MakeOpHandlers<0>(std::make_index_sequence<256>{}),
+    CpuImpl::MakeOpHandlers<1>(std::make_index_sequence<256>{}),
+    CpuImpl::MakeOpHandlers<2>(std::make_index_sequence<256>{})};
+
 template <>
 uint16_t CpuImpl::ReadEA16<AddressingMode::Indexed>() {
     return ReadIndexedEA();
@@ -1889,6 +2129,11 @@ Cpu::~Cpu() = default;
 
 void Cpu::Init(MemoryBus& memoryBus) {
     m_impl->Init(memoryBus);
+    m_impl->InvalidateDecodeCache();
+}
+
+void Cpu::InvalidateDecodeCache() {
+    m_impl->InvalidateDecodeCache();
 }
 
 void Cpu::Reset() {
@@ -1899,6 +2144,26 @@ cycles_t Cpu::ExecuteInstruction(bool irqEnabled, bool firqEnabled) {
     return m_impl->ExecuteInstruction(irqEnabled, firqEnabled);
 }
 
+int Cpu::ExecuteBlock(double cycleBudget, cycles_t& elapsedCycles) {
+    return m_impl->ExecuteBlock(cycleBudget, elapsedCycles);
+}
+
 const CpuRegisters& Cpu::Registers() {
     return *m_impl;
 }
+
+void Cpu::SetProfilingEnabled(bool enabled, int sampleInterval) {
+    if (enabled) {
+        m_impl->m_profile = std::make_unique<CpuProfile>(sampleInterval);
+    } else {
+        m_impl->m_profile.reset();
+    }
+}
+
+CpuProfile* Cpu::Profile() {
+    return m_impl->m_profile.get();
+}
+
+void Cpu::Serialize(Serializer& s) {
+    m_impl->Serialize(s);
+}
@@ -3,7 +3,9 @@
 #include "Base.h"
 #include "Pimpl.h"
 
+class CpuProfile;
 class MemoryBus;
+class Serializer;
 
 // Implementation of Motorola 68A09 1.5 MHz 8-Bit Microprocessor
 
@@ -69,8 +71,27 @@ public:
     void Reset();
     cycles_t ExecuteInstruction(bool irqEnabled, bool firqEnabled);
 
+    // Executes a block of previously executed ROM instructions up to the next jump, or until
+    // cycleBudget is used up. Returns the number of instructions executed, which is 0 if no block
+    // can be executed at PC (e.g. interrupts are unmasked), in which case use ExecuteInstruction.
+    // elapsedCycles is updated after each instruction, so memory bus devices can catch up on the
+    // cycles elapsed so far when they are accessed.
+    int ExecuteBlock(double cycleBudget, cycles_t& elapsedCycles);
+
+    // Must be called whenever ROM contents change (e.g. a new cartridge is loaded)
+    void InvalidateDecodeCache();
+
     const CpuRegisters& Registers();
 
+    // Starts counting executions and cycles per op code, timing every sampleInterval-th op if not
+    // 0, discarding any previous profile. When disabled, profiling costs a branch per instruction.
+    void SetProfilingEnabled(bool enabled, int sampleInterval = 0);
+
+    // Null if profiling is disabled
+    CpuProfile* Profile();
+
+    void Serialize(Serializer& s);
+
 private:
-    pimpl::Pimpl<class CpuImpl, 48> m_impl;
+    pimpl::Pimpl<class CpuImpl, 88> m_impl;
 };
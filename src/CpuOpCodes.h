@@ -1,4 +1,6 @@
 #pragma once
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
 enum class AddressingMode {
@@ -359,38 +361,40 @@ constexpr bool IsOpCodePage2(uint8_t firstByte) {
     return firstByte == 0x11;
 }
 
-constexpr const CpuOp& FindCpuOp(const CpuOp table[], uint8_t opCode, int index = 0) {
-    return table[index].opCode == opCode ? table[index] : FindCpuOp(table, opCode, index + 1);
-}
+namespace detail {
+    // Builds a table indexed by op code from a table of ops sorted by op code, filling the gaps with
+    // Illegal entries
+    template <size_t N>
+    constexpr std::array<CpuOp, 256> MakeDenseCpuOpTable(const CpuOp (&cpuOps)[N]) {
+        std::array<CpuOp, 256> table{};
+        for (size_t i = 0; i < table.size(); ++i) {
+            table[i] = {static_cast<uint8_t>(i), "Illegal", AddressingMode::Illegal, 1, 1,
+                        "Illegal"};
+        }
+        for (const auto& cpuOp : cpuOps)
+            table[cpuOp.opCode] = cpuOp;
+        return table;
+    }
 
-// Compile-time lookup - use LookupCpuOpRuntime for runtime lookups
-//@TODO: Make this faster and get rid of LookupCpuOpRuntime! One way is to fill up the page 1+2
-// tables with invalid entries so that valid entries are on their opCode index so we can look them
-// up the same way we do page 0.
-constexpr const CpuOp& LookupCpuOp(int page, uint8_t opCode) {
-    return page == 0 ? CpuOpsPage0[opCode]
-                     : page == 1 ? FindCpuOp(CpuOpsPage1, opCode) : FindCpuOp(CpuOpsPage2, opCode);
-}
+    constexpr bool IsDenseCpuOpTable(const CpuOp (&cpuOps)[256]) {
+        for (size_t i = 0; i < 256; ++i) {
+            if (cpuOps[i].opCode != i)
+                return false;
+        }
+        return true;
+    }
+} // namespace detail
 
-// Faster version for runtime lookup
-inline const CpuOp& LookupCpuOpRuntime(int page, uint8_t opCode) {
-    auto InitLookupTables = [] {
-        // static std::array<const struct CpuOp*, 256> opCodeTables[3];
-        static const CpuOp* opCodeTables[3][256];
-        for (auto& opCodeTable : opCodeTables)
-            std::fill(std::begin(opCodeTable), std::end(opCodeTable), nullptr);
+static_assert(detail::IsDenseCpuOpTable(CpuOpsPage0), "Page 0 ops must be indexed by op code");
 
-        for (size_t i = 0; i < NumCpuOpsPage0; ++i)
-            opCodeTables[0][CpuOpsPage0[i].opCode] = &CpuOpsPage0[i];
-        for (size_t i = 0; i < NumCpuOpsPage1; ++i)
-            opCodeTables[1][CpuOpsPage1[i].opCode] = &CpuOpsPage1[i];
-        for (size_t i = 0; i < NumCpuOpsPage2; ++i)
-            opCodeTables[2][CpuOpsPage2[i].opCode] = &CpuOpsPage2[i];
-        return opCodeTables;
-    };
+// Tables of ops for each page, indexed by op code
+inline constexpr std::array<CpuOp, 256> CpuOpTables[] = {
+    detail::MakeDenseCpuOpTable(CpuOpsPage0),
+    detail::MakeDenseCpuOpTable(CpuOpsPage1),
+    detail::MakeDenseCpuOpTable(CpuOpsPage2),
+};
 
-    static const auto& lookupTables = InitLookupTables();
-    auto cpuOp = lookupTables[page][opCode];
-    ASSERT_MSG(cpuOp != nullptr, "Invalid CPU opcode: %d, page: %d", opCode, page);
-    return *cpuOp;
+// Usable at compile time as well as at runtime
+constexpr const CpuOp& LookupCpuOp(int page, uint8_t opCode) {
+    return CpuOpTables[page][opCode];
 }
@@ -0,0 +1,118 @@
+#include "CpuProfile.h"
+#include "ConsoleOutput.h"
+#include "CpuOpCodes.h"
+#include "Stream.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+    const char* AddressingModeToString(AddressingMode addrMode) {
+        switch (addrMode) {
+        case AddressingMode::Relative:
+            return "Relative";
+        case AddressingMode::Inherent:
+            return "Inherent";
+        case AddressingMode::Immediate:
+            return "Immediate";
+        case AddressingMode::Direct:
+            return "Direct";
+        case AddressingMode::Indexed:
+            return "Indexed";
+        case AddressingMode::Extended:
+            return "Extended";
+        case AddressingMode::Illegal:
+            return "Illegal";
+        case AddressingMode::Variant:
+            return "Variant";
+        }
+        return "";
+    }
+
+    double AverageNanoseconds(const CpuProfile::OpStats& stats) {
+        return stats.sampledCount > 0
+                   ? static_cast<double>(stats.sampledNanoseconds) / stats.sampledCount
+                   : 0.0;
+    }
+
+    double Percent(uint64_t value, uint64_t total) {
+        return total > 0 ? 100.0 * value / total : 0.0;
+    }
+
+    struct ExecutedOp {
+        int page;
+        const CpuOp* cpuOp;
+        const CpuProfile::OpStats* stats;
+    };
+
+    std::vector<ExecutedOp> ExecutedOps(const CpuProfile& profile) {
+        std::vector<ExecutedOp> result;
+        for (int page = 0; page < 3; ++page) {
+            for (int opCode = 0; opCode < 256; ++opCode) {
+                auto& stats = profile.Stats(page, static_cast<uint8_t>(opCode));
+                if (stats.count > 0) {
+                    result.push_back(
+                        {page, &LookupCpuOp(page, static_cast<uint8_t>(opCode)), &stats});
+                }
+            }
+        }
+        return result;
+    }
+} // namespace
+
+void CpuProfile::Print(size_t maxOps) const {
+    auto ops = ExecutedOps(*this);
+    std::sort(ops.begin(), ops.end(),
+              [](auto& lhs, auto& rhs) { return lhs.stats->cycles > rhs.stats->cycles; });
+
+    OpStats total{};
+    std::array<OpStats, static_cast<size_t>(AddressingMode::Variant) + 1> modes{};
+    for (auto& op : ops) {
+        for (auto* stats : {&total, &modes[static_cast<size_t>(op.cpuOp->addrMode)]}) {
+            stats->count += op.stats->count;
+            stats->cycles += op.stats->cycles;
+            stats->sampledCount += op.stats->sampledCount;
+            stats->sampledNanoseconds += op.stats->sampledNanoseconds;
+        }
+    }
+
+    Printf("%-6s %-6s %-10s %12s %7s %14s %7s %8s\n", "page", "opcode", "name", "count",
+           "count%", "cycles", "cycles%", "avg ns");
+    for (size_t i = 0; i < std::min(maxOps, ops.size()); ++i) {
+        auto& op = ops[i];
+        Printf("%-6d $%02x    %-10s %12llu %6.2f%% %14llu %6.2f%% %8.1f\n", op.page,
+               op.cpuOp->opCode, op.cpuOp->name, (unsigned long long)op.stats->count,
+               Percent(op.stats->count, total.count), (unsigned long long)op.stats->cycles,
+               Percent(op.stats->cycles, total.cycles), AverageNanoseconds(*op.stats));
+    }
+
+    Printf("\n%-17s %12s %7s %14s %7s %8s\n", "addressing mode", "count", "count%", "cycles",
+           "cycles%", "avg ns");
+    for (size_t i = 0; i < modes.size(); ++i) {
+        auto& stats = modes[i];
+        if (stats.count == 0)
+            continue;
+        Printf("%-17s %12llu %6.2f%% %14llu %6.2f%% %8.1f\n",
+               AddressingModeToString(static_cast<AddressingMode>(i)),
+               (unsigned long long)stats.count, Percent(stats.count, total.count),
+               (unsigned long long)stats.cycles, Percent(stats.cycles, total.cycles),
+               AverageNanoseconds(stats));
+    }
+    Printf("%-17s %12llu %7s %14llu %7s %8.1f\n", "total", (unsigned long long)total.count, "",
+           (unsigned long long)total.cycles, "", AverageNanoseconds(total));
+}
+
+bool CpuProfile::WriteCsv(const char* file) const {
+    FileStream fs;
+    if (!fs.Open(file, "w"))
+        return false;
+
+    fs.Printf("page,opcode,name,addressing_mode,count,cycles,sampled_count,sampled_ns\n");
+    for (auto& op : ExecutedOps(*this)) {
+        fs.Printf("%d,0x%02x,%s,%s,%llu,%llu,%llu,%llu\n", op.page, op.cpuOp->opCode,
+                  op.cpuOp->name, AddressingModeToString(op.cpuOp->addrMode),
+                  (unsigned long long)op.stats->count, (unsigned long long)op.stats->cycles,
+                  (unsigned long long)op.stats->sampledCount,
+                  (unsigned long long)op.stats->sampledNanoseconds);
+    }
+    return true;
+}
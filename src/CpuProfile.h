@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Base.h"
+#include <array>
+
+// Executions and cycles per op code (page and op code byte), gathered by Cpu while profiling is
+// enabled. Totals per addressing mode are derived from these, as each op has a fixed mode.
+class CpuProfile {
+public:
+    struct OpStats {
+        uint64_t count{};
+        uint64_t cycles{};
+        uint64_t sampledCount{}; // Executions that were timed on the host
+        uint64_t sampledNanoseconds{};
+    };
+
+    // Every sampleInterval-th executed op is timed, or none if 0. Timing an op costs more than
+    // executing most ops, so keep this interval large enough for the timings to be meaningful.
+    explicit CpuProfile(int sampleInterval = 0)
+        : m_sampleInterval(sampleInterval) {}
+
+    OpStats& Stats(int page, uint8_t opCode) { return m_ops[page][opCode]; }
+    const OpStats& Stats(int page, uint8_t opCode) const { return m_ops[page][opCode]; }
+
+    // True if the op about to execute should be timed
+    bool Sample() {
+        if (m_sampleInterval <= 0 || ++m_sampleCounter < m_sampleInterval)
+            return false;
+        m_sampleCounter = 0;
+        return true;
+    }
+
+    int SampleInterval() const { return m_sampleInterval; }
+
+    void Reset() { m_ops = {}; }
+
+    // Prints the maxOps ops with the most cycles, followed by totals per addressing mode
+    void Print(size_t maxOps) const;
+
+    // Writes stats for every executed op as CSV
+    bool WriteCsv(const char* file) const;
+
+private:
+    std::array<std::array<OpStats, 256>, 3> m_ops{};
+    int m_sampleInterval{};
+    int m_sampleCounter{};
+};
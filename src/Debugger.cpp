@@ -1,16 +1,20 @@
 #include "Debugger.h"
-#include "CircularBuffer.h"
+#include "BiosSymbols.h"
 #include "ConsoleOutput.h"
 #include "Cpu.h"
-#include "CpuHelpers.h"
 #include "CpuOpCodes.h"
+#include "CpuProfile.h"
 #include "ErrorHandler.h"
+#include "HotSpotProfiler.h"
+#include "InstructionTrace.h"
 #include "MemoryBus.h"
 #include "Platform.h"
-#include "RegexHelpers.h"
+#include "Serializer.h"
 #include "Stream.h"
 #include "StringHelpers.h"
 #include "SyncProtocol.h"
+#include "TraceCapture.h"
+#include "TraceFile.h"
 #include "Via.h"
 #include <array>
 #include <cstdio>
@@ -36,36 +40,6 @@ namespace {
         decltype(Platform::GetConsoleCtrlHandler()) m_oldHandler;
     };
 
-    template <typename T>
-    T HexStringToIntegral(const char* s) {
-        std::stringstream converter(s);
-        int64_t value;
-        converter >> std::hex >> value;
-        return static_cast<T>(value);
-    }
-
-    template <typename T>
-    T HexStringToIntegral(const std::string& s) {
-        return HexStringToIntegral<T>(s.c_str());
-    }
-
-    template <typename T>
-    T StringToIntegral(std::string s) {
-        if (s.length() == 0)
-            return 0;
-
-        if (s[0] == '$') { // '$' Hex value
-            return HexStringToIntegral<T>(s.substr(1));
-        } else if (s[0] == '0' && s[1] == 'x' || s[1] == 'X') { // '0x' Hex value
-            return HexStringToIntegral<T>(s);
-        } else { // Integral value
-            int64_t value;
-            std::stringstream converter(s);
-            converter >> value;
-            return static_cast<T>(value);
-        }
-    }
-
     std::vector<std::string> Tokenize(const std::string& s) { return Split(s, " \t"); }
 
     std::string TryMemoryBusRead(const MemoryBus& memoryBus, uint16_t address) {
@@ -77,99 +51,14 @@ namespace {
         }
     }
 
-    const char* GetRegisterName(const CpuRegisters& cpuRegisters, const uint8_t& r) {
-        ptrdiff_t offset =
-            reinterpret_cast<const uint8_t*>(&r) - reinterpret_cast<const uint8_t*>(&cpuRegisters);
-        switch (offset) {
-        case offsetof(CpuRegisters, A):
-            return "A";
-        case offsetof(CpuRegisters, B):
-            return "B";
-        case offsetof(CpuRegisters, DP):
-            return "DP";
-        case offsetof(CpuRegisters, CC):
-            return "CC";
-        default:
-            FAIL();
-            return "INVALID";
-        }
-    };
-
-    const char* GetRegisterName(const CpuRegisters& cpuRegisters, const uint16_t& r) {
-        ptrdiff_t offset =
-            reinterpret_cast<const uint8_t*>(&r) - reinterpret_cast<const uint8_t*>(&cpuRegisters);
-        switch (offset) {
-        case offsetof(CpuRegisters, X):
-            return "X";
-        case offsetof(CpuRegisters, Y):
-            return "Y";
-        case offsetof(CpuRegisters, U):
-            return "U";
-        case offsetof(CpuRegisters, S):
-            return "S";
-        case offsetof(CpuRegisters, PC):
-            return "PC";
-        case offsetof(CpuRegisters, D):
-            return "D";
-        default:
-            FAIL();
-            return "INVALID";
-        }
-    };
-
-    struct Instruction {
-        const CpuOp* cpuOp;
-        int page;
-        std::array<uint8_t, 5> opBytes; // Max 2 byte opcode + 3 byte operands
-        size_t firstOperandIndex = 0;
-
-        uint8_t GetOperand(size_t index) const { return opBytes[firstOperandIndex + index]; }
-    };
-
-    struct InstructionTraceInfo {
-        Instruction instruction{};
-        CpuRegisters preOpCpuRegisters;
-        CpuRegisters postOpCpuRegisters{};
-        cycles_t elapsedCycles{};
-
-        static const size_t MaxMemoryAccesses = 16;
-        struct MemoryAccess {
-            uint16_t address{};
-            uint16_t value{};
-            bool read{};
-        };
-        std::array<MemoryAccess, MaxMemoryAccesses> memoryAccesses;
-        size_t numMemoryAccesses = 0;
-
-        void AddMemoryAccess(uint16_t address, uint16_t value, bool read) {
-            assert(numMemoryAccesses < memoryAccesses.size());
-            memoryAccesses[numMemoryAccesses++] = {address, value, read};
-        }
-    };
-
     Instruction ReadInstruction(uint16_t opAddr, const MemoryBus& memoryBus) {
-        Instruction instruction{};
-
         // Always read max opBytes size even if not all the bytes are for this instruction. We can't
         // really know up front how many bytes an op will take because indexed instructions
         // sometimes read an extra operand byte (determined dynamically).
-        for (auto& byte : instruction.opBytes)
+        std::array<uint8_t, 5> opBytes;
+        for (auto& byte : opBytes)
             byte = memoryBus.Read(opAddr++);
-
-        int cpuOpPage = 0;
-        size_t opCodeIndex = 0;
-        if (IsOpCodePage1(instruction.opBytes[opCodeIndex])) {
-            cpuOpPage = 1;
-            ++opCodeIndex;
-        } else if (IsOpCodePage2(instruction.opBytes[opCodeIndex])) {
-            cpuOpPage = 2;
-            ++opCodeIndex;
-        }
-
-        instruction.cpuOp = &LookupCpuOpRuntime(cpuOpPage, instruction.opBytes[opCodeIndex]);
-        instruction.page = cpuOpPage;
-        instruction.firstOperandIndex = opCodeIndex + 1;
-        return instruction;
+        return DecodeInstruction(opBytes);
     }
 
     void PreOpWriteTraceInfo(InstructionTraceInfo& traceInfo, const CpuRegisters& cpuRegisters,
@@ -186,376 +75,6 @@ namespace {
         traceInfo.elapsedCycles = elapsedCycles;
     }
 
-    void DisassembleOp_EXG_TFR(const Instruction& instruction, const CpuRegisters& cpuRegisters,
-                               std::string& disasmInstruction, std::string& comment) {
-        (void)cpuRegisters;
-        (void)comment;
-
-        const auto& cpuOp = instruction.cpuOp;
-        ASSERT(cpuOp->addrMode == AddressingMode::Inherent);
-        uint8_t postbyte = instruction.GetOperand(0);
-        uint8_t src = (postbyte >> 4) & 0b111;
-        uint8_t dst = postbyte & 0b111;
-        if (postbyte & BITS(3)) {
-            const char* const regName[]{"A", "B", "CC", "DP"};
-            disasmInstruction =
-                FormattedString<>("%s %s,%s", cpuOp->name, regName[src], regName[dst]);
-        } else {
-            const char* const regName[]{"D", "X", "Y", "U", "S", "PC"};
-            disasmInstruction =
-                FormattedString<>("%s %s,%s", cpuOp->name, regName[src], regName[dst]);
-        }
-    }
-
-    void DisassembleOp_PSH_PUL(const Instruction& instruction, const CpuRegisters& cpuRegisters,
-                               std::string& disasmInstruction, std::string& comment) {
-        (void)cpuRegisters;
-
-        const auto& cpuOp = instruction.cpuOp;
-        ASSERT(cpuOp->addrMode == AddressingMode::Immediate);
-        auto value = instruction.GetOperand(0);
-        std::vector<std::string> registers;
-        if (value & BITS(0))
-            registers.push_back("CC");
-        if (value & BITS(1))
-            registers.push_back("A");
-        if (value & BITS(2))
-            registers.push_back("B");
-        if (value & BITS(3))
-            registers.push_back("DP");
-        if (value & BITS(4))
-            registers.push_back("X");
-        if (value & BITS(5))
-            registers.push_back("Y");
-        if (value & BITS(6)) {
-            registers.push_back(cpuOp->opCode < 0x36 ? "U" : "S");
-        }
-        if (value & BITS(7))
-            registers.push_back("PC");
-
-        disasmInstruction = FormattedString<>("%s %s", cpuOp->name, Join(registers, ",").c_str());
-        comment = FormattedString<>("#$%02x (%d)", value, value);
-    }
-
-    void DisassembleIndexedInstruction(const Instruction& instruction,
-                                       const CpuRegisters& cpuRegisters,
-                                       std::string& disasmInstruction, std::string& comment) {
-        auto RegisterSelect = [&cpuRegisters](uint8_t postbyte) -> const uint16_t& {
-            switch ((postbyte >> 5) & 0b11) {
-            case 0b00:
-                return cpuRegisters.X;
-            case 0b01:
-                return cpuRegisters.Y;
-            case 0b10:
-                return cpuRegisters.U;
-            default: // 0b11:
-                return cpuRegisters.S;
-            }
-        };
-
-        uint16_t EA = 0;
-        uint8_t postbyte = instruction.GetOperand(0);
-        bool supportsIndirect = true;
-        std::string operands;
-
-        if ((postbyte & BITS(7)) == 0) // (+/- 4 bit offset),R
-        {
-            // postbyte is a 5 bit two's complement number we convert to 8 bit.
-            // So if bit 4 is set (sign bit), we extend the sign bit by turning on bits 6,7,8;
-            int8_t offset = postbyte & 0b0001'1111;
-            if (postbyte & BITS(4))
-                offset |= 0b1110'0000;
-            auto& reg = RegisterSelect(postbyte);
-            EA = reg + offset;
-            supportsIndirect = false;
-
-            operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
-            comment = FormattedString<>("%d,$%04x", offset, reg);
-        } else {
-            switch (postbyte & 0b1111) {
-            case 0b0000: { // ,R+
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg;
-                supportsIndirect = false;
-
-                operands = FormattedString<>(",%s+", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>(",$%04x+", reg);
-            } break;
-            case 0b0001: { // ,R++
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg;
-
-                operands = FormattedString<>(",%s++", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>(",$%04x++", reg);
-            } break;
-            case 0b0010: { // ,-R
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg - 1;
-                supportsIndirect = false;
-
-                operands = FormattedString<>(",-%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>(",-$%04x", reg);
-            } break;
-            case 0b0011: { // ,--R
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg - 2;
-
-                operands = FormattedString<>(",--%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>(",--$%04x", reg);
-            } break;
-            case 0b0100: { // ,R
-                auto& reg = RegisterSelect(postbyte);
-                EA = reg;
-
-                operands = FormattedString<>(",%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>(",$%04x", reg);
-            } break;
-            case 0b0101: { // (+/- B),R
-                auto& reg = RegisterSelect(postbyte);
-                auto offset = S16(cpuRegisters.B);
-                EA = reg + offset;
-
-                operands = FormattedString<>("B,%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>("%d,$%04x", offset, reg);
-            } break;
-            case 0b0110: { // (+/- A),R
-                auto& reg = RegisterSelect(postbyte);
-                auto offset = S16(cpuRegisters.A);
-                EA = reg + offset;
-
-                operands = FormattedString<>("A,%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>("%d,$%04x", offset, reg);
-            } break;
-            case 0b0111:
-                FAIL_MSG("Illegal");
-                break;
-            case 0b1000: { // (+/- 7 bit offset),R
-                auto& reg = RegisterSelect(postbyte);
-                uint8_t postbyte2 = instruction.GetOperand(1);
-                auto offset = S16(postbyte2);
-                EA = reg + offset;
-
-                operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>("%d,$%04x", offset, reg);
-            } break;
-            case 0b1001: { // (+/- 15 bit offset),R
-                uint8_t postbyte2 = instruction.GetOperand(1);
-                uint8_t postbyte3 = instruction.GetOperand(2);
-                auto& reg = RegisterSelect(postbyte);
-                auto offset = CombineToS16(postbyte2, postbyte3);
-                EA = reg + offset;
-
-                operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>("%d,$%04x", offset, reg);
-            } break;
-            case 0b1010:
-                FAIL_MSG("Illegal");
-                break;
-            case 0b1011: { // (+/- D),R
-                auto& reg = RegisterSelect(postbyte);
-                auto offset = S16(cpuRegisters.D);
-                EA = reg + offset;
-
-                operands = FormattedString<>("D,%s", GetRegisterName(cpuRegisters, reg));
-                comment = FormattedString<>("%d,$%04x", offset, reg);
-            } break;
-            case 0b1100: { // (+/- 7 bit offset),PC
-                uint8_t postbyte2 = instruction.GetOperand(1);
-                auto offset = S16(postbyte2);
-                EA = cpuRegisters.PC + offset;
-
-                operands = FormattedString<>("%d,PC", offset);
-                comment = FormattedString<>("%d,$%04x", offset, cpuRegisters.PC);
-            } break;
-            case 0b1101: { // (+/- 15 bit offset),PC
-                uint8_t postbyte2 = instruction.GetOperand(1);
-                uint8_t postbyte3 = instruction.GetOperand(2);
-                auto offset = CombineToS16(postbyte2, postbyte3);
-                EA = cpuRegisters.PC + offset;
-
-                operands = FormattedString<>("%d,PC", offset);
-                comment = FormattedString<>("%d,$%04x", offset, cpuRegisters.PC);
-            } break;
-            case 0b1110:
-                FAIL_MSG("Illegal");
-                break;
-            case 0b1111: { // [address] (Indirect-only)
-                uint8_t postbyte2 = instruction.GetOperand(1);
-                uint8_t postbyte3 = instruction.GetOperand(2);
-                EA = CombineToS16(postbyte2, postbyte3);
-            } break;
-            default:
-                FAIL_MSG("Illegal");
-                break;
-            }
-        }
-
-        if (supportsIndirect && (postbyte & BITS(4))) {
-            operands = FormattedString<>("[$%04x]", EA);
-        }
-
-        disasmInstruction = std::string(instruction.cpuOp->name) + " " + operands;
-    }
-
-    struct DisassembledOp {
-        std::string hexInstruction;
-        std::string disasmInstruction;
-        std::string comment;
-        std::string description;
-    };
-
-    DisassembledOp DisassembleOp(const InstructionTraceInfo& traceInfo,
-                                 const Debugger::SymbolTable& symbolTable) {
-        const auto& instruction = traceInfo.instruction;
-        const auto& cpuRegisters = traceInfo.preOpCpuRegisters;
-        const auto& cpuOp = instruction.cpuOp;
-
-        // Output instruction in hex
-        std::string hexInstruction;
-        for (uint16_t i = 0; i < cpuOp->size; ++i) {
-            hexInstruction += FormattedString<>("%02x", instruction.opBytes[i]);
-        }
-
-        std::string disasmInstruction, comment;
-
-        // First see if we have instruction-specific handlers. These are for special cases where the
-        // default addressing mode handlers don't give enough information.
-        bool handled = true;
-        switch (cpuOp->opCode) {
-        case 0x1E: // EXG
-        case 0x1F: // TFR
-            DisassembleOp_EXG_TFR(instruction, cpuRegisters, disasmInstruction, comment);
-            break;
-
-        case 0x34: // PSHS
-        case 0x35: // PULS
-        case 0x36: // PSHU
-        case 0x37: // PULU
-            DisassembleOp_PSH_PUL(instruction, cpuRegisters, disasmInstruction, comment);
-            break;
-
-        default:
-            handled = false;
-        }
-
-        // If no instruction-specific handler, we disassemble based on addressing mode.
-        if (!handled) {
-            switch (cpuOp->addrMode) {
-            case AddressingMode::Inherent: {
-                disasmInstruction = cpuOp->name;
-            } break;
-
-            case AddressingMode::Immediate: {
-                if (cpuOp->size == 2) {
-                    auto value = instruction.GetOperand(0);
-                    disasmInstruction = FormattedString<>("%s #$%02x", cpuOp->name, value);
-                    comment = FormattedString<>("(%d)", value);
-                } else {
-                    auto value = CombineToU16(instruction.GetOperand(0), instruction.GetOperand(1));
-                    disasmInstruction = FormattedString<>("%s #$%04x", cpuOp->name, value);
-                    comment = FormattedString<>("(%d)", value);
-                }
-            } break;
-
-            case AddressingMode::Extended: {
-                auto msb = instruction.GetOperand(0);
-                auto lsb = instruction.GetOperand(1);
-                uint16_t EA = CombineToU16(msb, lsb);
-                disasmInstruction = FormattedString<>("%s $%04x", cpuOp->name, EA);
-            } break;
-
-            case AddressingMode::Direct: {
-                uint16_t EA = CombineToU16(cpuRegisters.DP, instruction.GetOperand(0));
-                disasmInstruction =
-                    FormattedString<>("%s $%02x", cpuOp->name, instruction.GetOperand(0));
-                comment = FormattedString<>("DP:(PC) = $%02x", EA);
-            } break;
-
-            case AddressingMode::Indexed: {
-                DisassembleIndexedInstruction(instruction, cpuRegisters, disasmInstruction,
-                                              comment);
-            } break;
-
-            case AddressingMode::Relative: {
-                // Branch instruction with 8 or 16 bit signed relative offset
-                uint16_t nextPC = cpuRegisters.PC + cpuOp->size;
-                if (cpuOp->size == 2) {
-                    auto offset = static_cast<int8_t>(instruction.GetOperand(0));
-                    disasmInstruction =
-                        FormattedString<>("%s $%02x", cpuOp->name, U16(offset) & 0x00FF);
-                    comment =
-                        FormattedString<>("(%d), PC + offset = $%04x", offset, nextPC + offset);
-                } else {
-                    // Could be a long branch from page 0 (3 bytes) or page 1 (4 bytes)
-                    ASSERT(cpuOp->size >= 3);
-                    auto offset = static_cast<int16_t>(
-                        CombineToU16(instruction.GetOperand(0), instruction.GetOperand(1)));
-                    disasmInstruction = FormattedString<>("%s $%04x", cpuOp->name, offset);
-                    comment =
-                        FormattedString<>("(%d), PC + offset = $%04x", offset, nextPC + offset);
-                }
-            } break;
-
-            case AddressingMode::Illegal: {
-            case AddressingMode::Variant:
-                FAIL_MSG("Unexpected addressing mode");
-            } break;
-            }
-        }
-
-        // Appends symbol names to known addresses
-        auto AppendSymbols = [&symbolTable](const std::string& s) {
-            if (!symbolTable.empty()) {
-                auto AppendSymbol = [&symbolTable](const std::smatch& m) -> std::string {
-                    std::string result = m.str(0);
-                    uint16_t address = StringToIntegral<uint16_t>(m.str(0));
-
-                    auto range = symbolTable.equal_range(address);
-                    if (range.first != range.second) {
-                        std::vector<std::string> symbols;
-                        std::transform(range.first, range.second, std::back_inserter(symbols),
-                                       [](auto& kvp) { return kvp.second; });
-
-                        result += "{" + Join(symbols, "|") + "}";
-                    }
-                    return result;
-                };
-
-                std::regex re("\\$[A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9]");
-                return RegexReplace(s, re, AppendSymbol);
-            }
-            return s;
-        };
-
-        // Append memory accesses to comment section (if any)
-        {
-            // Skip the opcode + operand bytes - @TODO: we probably shouldn't be storing these in
-            // the first place
-            const size_t skipBytes = traceInfo.instruction.cpuOp->size;
-            const bool initialSpace = !comment.empty();
-            for (size_t i = skipBytes; i < traceInfo.numMemoryAccesses; ++i) {
-                auto& ma = traceInfo.memoryAccesses[i];
-                const char* separator = i == skipBytes ? (initialSpace ? " " : "") : " ";
-                comment += FormattedString<>("%s$%04x%s$%x", separator, ma.address,
-                                             ma.read ? "->" : "<-", ma.value);
-            }
-        }
-
-        disasmInstruction = AppendSymbols(disasmInstruction);
-        comment = AppendSymbols(comment);
-
-        return {hexInstruction, disasmInstruction, comment, cpuOp->description};
-    };
-
-    std::string GetCCString(const CpuRegisters& cpuRegisters) {
-        const auto& cc = cpuRegisters.CC;
-        return FormattedString<>("%c%c%c%c%c%c%c%c", cc.Entire ? 'E' : 'e',
-                                 cc.FastInterruptMask ? 'F' : 'f', cc.HalfCarry ? 'H' : 'h',
-                                 cc.InterruptMask ? 'I' : 'i', cc.Negative ? 'N' : 'n',
-                                 cc.Zero ? 'Z' : 'z', cc.Overflow ? 'V' : 'v', cc.Carry ? 'C' : 'c')
-            .Value();
-    }
-
     void PrintRegisters(const CpuRegisters& cpuRegisters) {
         const auto& r = cpuRegisters;
         Printf("A=$%02x (%d) B=$%02x (%d) D=$%04x (%d) X=$%04x (%d) "
@@ -564,30 +83,6 @@ namespace {
                GetCCString(cpuRegisters).c_str());
     }
 
-    void PrintRegistersCompact(const CpuRegisters& cpuRegisters) {
-        const auto& r = cpuRegisters;
-        Printf("A$%02x|B$%02x|X$%04x|Y$%04x|U$%04x|S$%04x|DP$%02x|%s", r.A, r.B, r.X, r.Y, r.U, r.S,
-               r.DP, GetCCString(cpuRegisters).c_str());
-    }
-
-    void PrintOp(const InstructionTraceInfo& traceInfo, const Debugger::SymbolTable& symbolTable) {
-        auto op = DisassembleOp(traceInfo, symbolTable);
-
-        using namespace Platform;
-        ScopedConsoleColor scc(ConsoleColor::Gray);
-        Printf("[$%04x] ", traceInfo.preOpCpuRegisters.PC);
-        SetConsoleColor(ConsoleColor::LightYellow);
-        Printf("%-10s ", op.hexInstruction.c_str());
-        SetConsoleColor(ConsoleColor::LightAqua);
-        Printf("%-32s ", op.disasmInstruction.c_str());
-        SetConsoleColor(ConsoleColor::LightGreen);
-        Printf("%-40s ", op.comment.c_str());
-        SetConsoleColor(ConsoleColor::LightPurple);
-        Printf("%2llu ", traceInfo.elapsedCycles);
-        PrintRegistersCompact(traceInfo.postOpCpuRegisters);
-        Printf("\n");
-    }
-
     void PrintHelp() {
         Printf("s[tep] [count]               step instruction [count] times\n"
                "c[ontinue]                   continue running\n"
@@ -605,32 +100,29 @@ namespace {
                "toggle ...                   toggle input option\n"
                "  color                        colored output (slow)\n"
                "  trace                        disassembly trace\n"
+               "  blocks                       block execution (when not tracing)\n"
                "option ...                   set option\n"
                "  errors [ignore|log|fail]     error policy\n"
                "t[race] [...]                display trace output\n"
                "  -n <num_lines>               display num_lines worth\n"
                "  -f <file_name>               output trace to file_name\n"
+               "stream <file_name>|off       stream binary trace to file_name (or stop)\n"
+               "profile ...                  op code execution profiler\n"
+               "  on [sample_interval]         start (timing every sample_interval-th op)\n"
+               "  off                          stop and discard\n"
+               "  reset                        clear counts\n"
+               "  print [num_ops]              display top ops by cycles, and addressing modes\n"
+               "  csv <file_name>              output counts of every op to file_name\n"
+               "hotspot ...                  guest code profiler by address and call stack\n"
+               "  on                           start\n"
+               "  off                          stop and discard\n"
+               "  reset                        clear counts\n"
+               "  print [num_entries]          display top functions and symbol ranges\n"
+               "  folded <file_name>           output folded call stacks for flame graphs\n"
                "q[uit]                       quit\n"
                "h[elp]                       display this help text\n");
     }
 
-    bool LoadUserSymbolsFile(const char* file, Debugger::SymbolTable& symbolTable) {
-        std::ifstream fin(file);
-        if (!fin)
-            return false;
-
-        std::string line;
-        while (std::getline(fin, line)) {
-            auto tokens = Tokenize(line);
-            if (tokens.size() >= 3 && ((tokens[1].find("EQU") != -1) ||
-                                       (tokens[1].find("equ") != -1) || (tokens[1] == ":"))) {
-                auto address = StringToIntegral<uint16_t>(tokens[2]);
-                symbolTable.insert({address, tokens[0]});
-            }
-        }
-        return true;
-    }
-
     void SetColorEnabled(bool enabled) {
         Platform::SetConsoleColoringEnabled(enabled);
         if (enabled) {
@@ -642,56 +134,21 @@ namespace {
         }
     }
 
-    inline uint32_t Crc32(uint32_t crc, const void* buffer, size_t len) {
-        // CRC-32C (iSCSI) polynomial in reversed bit order.
-        const auto POLY = 0x82f63b78;
-        // CRC-32 (Ethernet, ZIP, etc.) polynomial in reversed bit order.
-        // const auto POLY = 0xedb88320;
-
-        auto buf = reinterpret_cast<const uint8_t*>(buffer);
-
-        crc = ~crc;
-        while (len--) {
-            crc ^= *buf++;
-            for (int k = 0; k < 8; k++)
-                crc = crc & 1 ? (crc >> 1) ^ POLY : crc >> 1;
-        }
-        return ~crc;
-    }
-
-    template <typename T>
-    uint32_t Crc32(uint32_t crc, const T& value) {
-        return Crc32(crc, &value, sizeof(value));
-    }
-
-    uint32_t HashInstructionTraceInfo(uint32_t currInstructionHash,
-                                      const InstructionTraceInfo& traceInfo) {
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.instruction.cpuOp->opCode);
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.instruction.cpuOp->addrMode);
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.instruction.page);
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.elapsedCycles);
-        for (size_t i = 0; i < traceInfo.numMemoryAccesses; ++i) {
-            currInstructionHash += Crc32(currInstructionHash, traceInfo.memoryAccesses[i].address);
-            currInstructionHash += Crc32(currInstructionHash, traceInfo.memoryAccesses[i].read);
-            currInstructionHash += Crc32(currInstructionHash, traceInfo.memoryAccesses[i].value);
-        }
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.preOpCpuRegisters);
-        currInstructionHash += Crc32(currInstructionHash, traceInfo.postOpCpuRegisters);
-        return currInstructionHash;
-    }
-
-    // Global variables
     const size_t MaxTraceInstructions = 1000'000;
-    CircularBuffer<InstructionTraceInfo> g_instructionTraceBuffer(MaxTraceInstructions);
-    InstructionTraceInfo* g_currTraceInfo = nullptr;
 
 } // namespace
 
+Debugger::Debugger() = default;
+Debugger::~Debugger() = default;
+
 void Debugger::Init(MemoryBus& memoryBus, Cpu& cpu, Via& via) {
     m_memoryBus = &memoryBus;
     m_cpu = &cpu;
     m_via = &via;
 
+    for (auto& [address, name] : BiosSymbols)
+        m_symbolTable.insert({address, name});
+
     Platform::SetConsoleCtrlHandler([this] {
         BreakIntoDebugger();
         return true;
@@ -707,45 +164,113 @@ void Debugger::Init(MemoryBus& memoryBus, Cpu& cpu, Via& via) {
     // Enable trace by default?
     m_traceEnabled = true;
 
+    UpdateMemoryBusCallbacks();
+
+    // Load up commands for debugger to execute on startup
+    std::ifstream fin("startup.txt");
+    if (fin) {
+        std::string command;
+        while (std::getline(fin, command)) {
+            if (!command.empty())
+                m_pendingCommands.push(command);
+        }
+    }
+}
+
+void Debugger::UpdateMemoryBusCallbacks() {
+    // Memory bus callbacks are only needed for tracing and watchpoints, so unregister them when
+    // neither is active to keep memory accesses on the fast path.
+    if (!m_traceEnabled && !m_breakpoints.HasEnabledWatchpoints()) {
+        m_memoryBus->UnregisterCallbacks();
+        return;
+    }
+
+    // Re-registered whenever a command may have changed watchpoints
+    const bool checkWatchpoints = m_breakpoints.HasEnabledWatchpoints();
     m_memoryBus->RegisterCallbacks(
         // OnRead
-        [&](uint16_t address, uint8_t value) {
-            if (m_traceEnabled && g_currTraceInfo) {
-                g_currTraceInfo->AddMemoryAccess(address, value, true);
+        [this, checkWatchpoints](uint16_t address, uint8_t value) {
+            if (m_traceEnabled && m_currTraceInfo) {
+                m_currTraceInfo->AddMemoryAccess(address, value, true);
             }
 
-            if (auto bp = m_breakpoints.Get(address)) {
-                if (bp->enabled && (bp->type == Breakpoint::Type::Read ||
-                                    bp->type == Breakpoint::Type::ReadWrite)) {
-                    BreakIntoDebugger();
-                    Printf("Watchpoint hit at $%04x (read value $%02x)\n", address, value);
-                }
+            if (checkWatchpoints && m_breakpoints.BreaksOnRead(address)) {
+                BreakIntoDebugger();
+                Printf("Watchpoint hit at $%04x (read value $%02x)\n", address, value);
             }
         },
         // OnWrite
-        [&](uint16_t address, uint8_t value) {
-            if (m_traceEnabled && g_currTraceInfo) {
-                g_currTraceInfo->AddMemoryAccess(address, value, false);
+        [this, checkWatchpoints](uint16_t address, uint8_t value) {
+            if (m_traceEnabled && m_currTraceInfo) {
+                m_currTraceInfo->AddMemoryAccess(address, value, false);
             }
 
-            if (auto bp = m_breakpoints.Get(address)) {
-                if (bp->enabled && (bp->type == Breakpoint::Type::Write ||
-                                    bp->type == Breakpoint::Type::ReadWrite)) {
-                    BreakIntoDebugger();
-                    Printf("Watchpoint hit at $%04x (write value $%02x)\n", address, value);
-                }
+            if (checkWatchpoints && m_breakpoints.BreaksOnWrite(address)) {
+                BreakIntoDebugger();
+                Printf("Watchpoint hit at $%04x (write value $%02x)\n", address, value);
             }
         });
+}
 
-    // Load up commands for debugger to execute on startup
-    std::ifstream fin("startup.txt");
-    if (fin) {
-        std::string command;
-        while (std::getline(fin, command)) {
-            if (!command.empty())
-                m_pendingCommands.push(command);
-        }
+void Debugger::SetTraceEnabled(bool enabled) {
+    m_traceEnabled = enabled;
+    UpdateMemoryBusCallbacks();
+}
+
+void Debugger::SetBlockExecutionEnabled(bool enabled) {
+    m_blockExecutionEnabled = enabled;
+}
+
+TraceCapture& Debugger::GetTraceCapture() {
+    // Created on first use, as the trace history takes a lot of memory
+    if (!m_traceCapture) {
+        m_traceCapture = std::make_unique<TraceCapture>(MaxTraceInstructions);
+        m_traceCapture->Hasher().Init(m_hashMode, m_hashGranularity);
     }
+    return *m_traceCapture;
+}
+
+void Debugger::SetInstructionHashing(InstructionHasher::Mode mode, size_t granularity) {
+    m_hashMode = mode;
+    m_hashGranularity = granularity;
+    if (m_traceCapture) {
+        m_traceCapture->Flush();
+        m_traceCapture->Hasher().Init(m_hashMode, m_hashGranularity);
+    }
+}
+
+bool Debugger::StartTraceFile(const char* file) {
+    StopTraceFile();
+    auto traceFile = std::make_unique<TraceFileWriter>();
+    if (!traceFile->Open(file))
+        return false;
+    auto& traceCapture = GetTraceCapture();
+    traceCapture.Flush();
+    traceCapture.SetTraceFile(std::move(traceFile));
+    SetTraceEnabled(true);
+    return true;
+}
+
+void Debugger::StopTraceFile() {
+    if (!m_traceCapture)
+        return;
+    m_traceCapture->Flush();
+    auto traceFile = m_traceCapture->TraceFile();
+    if (!traceFile)
+        return;
+    const bool written = traceFile->Close();
+    Printf("Wrote trace of %llu instructions (%llu bytes)%s\n",
+           (unsigned long long)traceFile->NumRecords(), (unsigned long long)traceFile->NumBytes(),
+           written ? "" : ", with write errors");
+    m_traceCapture->SetTraceFile(nullptr);
+}
+
+void Debugger::SetHotSpotProfilingEnabled(bool enabled) {
+    m_hotSpotProfiler = enabled ? std::make_unique<HotSpotProfiler>(m_symbolTable) : nullptr;
+}
+
+HotSpotProfiler* Debugger::HotSpotProfile() {
+    return m_hotSpotProfiler.get();
 }
 
 void Debugger::Reset() {
@@ -754,8 +279,15 @@ void Debugger::Reset() {
     // m_breakpoints.Reset();
     m_cpuCyclesTotal = 0;
     m_cpuCyclesLeft = 0;
-    g_instructionTraceBuffer.Clear();
-    g_currTraceInfo = nullptr;
+    if (m_traceCapture) {
+        m_traceCapture->Flush();
+        m_traceCapture->History().Clear();
+    }
+    m_currTraceInfo = nullptr;
+}
+
+void Debugger::Serialize(Serializer& s) {
+    s.Serialize(m_cpuCyclesLeft, m_cpuCyclesTotal, m_instructionCount);
 }
 
 void Debugger::BreakIntoDebugger() {
@@ -775,14 +307,24 @@ void Debugger::SyncInstructionHash(SyncProtocol& syncProtocol,
 
     bool hashMismatch = false;
 
+    // Hashes are computed as instructions are processed by the trace capture thread
+    InstructionHasher* hasher = nullptr;
+    uint32_t instructionHash = 0;
+    if (m_traceCapture) {
+        m_traceCapture->Flush();
+        hasher = &m_traceCapture->Hasher();
+        hasher->EndFrame();
+        instructionHash = hasher->Hash();
+    }
+
     // Sync hashes and compare
     if (syncProtocol.IsServer()) {
-        syncProtocol.SendValue(ConnectionType::Server, m_instructionHash);
+        syncProtocol.SendValue(ConnectionType::Server, instructionHash);
 
     } else if (syncProtocol.IsClient()) {
         uint32_t serverInstructionHash{};
         syncProtocol.RecvValue(ConnectionType::Client, serverInstructionHash);
-        hashMismatch = m_instructionHash != serverInstructionHash;
+        hashMismatch = instructionHash != serverInstructionHash;
     }
 
     // Sync whether to continue or stop
@@ -793,8 +335,7 @@ void Debugger::SyncInstructionHash(SyncProtocol& syncProtocol,
     }
 
     if (hashMismatch) {
-        Errorf("Instruction hash mismatch in last %d instructions\n",
-               numInstructionsExecutedThisFrame);
+        FindInstructionHashMismatch(syncProtocol, numInstructionsExecutedThisFrame);
 
         // @TODO: Unfortunately, we still deadlock when multiple instances call BreakIntoDebugger at
         // the same time, so for now, just don't do it.
@@ -806,6 +347,132 @@ void Debugger::SyncInstructionHash(SyncProtocol& syncProtocol,
         else
             syncProtocol.ShutdownClient();
     }
+
+    if (hasher)
+        hasher->BeginFrame();
+}
+
+void Debugger::FindInstructionHashMismatch(SyncProtocol& syncProtocol,
+                                           int numInstructionsExecutedThisFrame) {
+    // The hashes matched up to the previous frame, so the first checkpoint that differs narrows
+    // down where this frame diverged, then the client bisects that range with the server, asking
+    // for the hash after a given instruction until it finds the first one that differs. Both
+    // instances must use the same hash settings. An instance without trace capture takes part with
+    // no hashes.
+    const uint32_t NoIndex = ~0u;
+
+    std::vector<uint32_t> checkpoints;
+    std::vector<InstructionTraceInfo> frameTrace;
+    std::vector<uint32_t> instructionHashes;
+    if (m_traceCapture) {
+        const auto& hasher = m_traceCapture->Hasher();
+        checkpoints = hasher.Checkpoints();
+
+        // The history holds many more instructions than are executed in a frame
+        auto& history = m_traceCapture->History();
+        frameTrace.resize(std::min(hasher.InstructionsInFrame(), history.UsedSize()));
+        frameTrace.resize(history.PeekBack(frameTrace.data(), frameTrace.size()));
+
+        InstructionHasher instructionHasher;
+        instructionHasher.Init(m_hashMode, 1);
+        for (auto& traceInfo : frameTrace)
+            instructionHasher.Add(traceInfo);
+        instructionHashes = instructionHasher.Checkpoints();
+    }
+    const auto numCheckpoints = static_cast<uint32_t>(checkpoints.size());
+    const auto numHashes = static_cast<uint32_t>(instructionHashes.size());
+
+    if (syncProtocol.IsServer()) {
+        syncProtocol.SendValue(ConnectionType::Server, numCheckpoints);
+        for (uint32_t checkpoint : checkpoints)
+            syncProtocol.SendValue(ConnectionType::Server, checkpoint);
+
+        syncProtocol.SendValue(ConnectionType::Server, numHashes);
+        while (true) {
+            uint32_t index{};
+            syncProtocol.RecvValue(ConnectionType::Server, index);
+            if (index == NoIndex)
+                break;
+            syncProtocol.SendValue(ConnectionType::Server, instructionHashes[index]);
+        }
+
+        uint32_t mismatchIndex{};
+        syncProtocol.RecvValue(ConnectionType::Server, mismatchIndex);
+        const bool hasTraceInfo = mismatchIndex < frameTrace.size();
+        syncProtocol.SendValue(ConnectionType::Server, hasTraceInfo);
+        if (hasTraceInfo)
+            syncProtocol.SendValue(ConnectionType::Server, frameTrace[mismatchIndex]);
+
+        Errorf("Instruction hash mismatch at instruction %u of last %d instructions\n",
+               mismatchIndex, numInstructionsExecutedThisFrame);
+        if (hasTraceInfo) {
+            Printf("Server:\n");
+            PrintOp(frameTrace[mismatchIndex], m_symbolTable);
+        }
+
+    } else if (syncProtocol.IsClient()) {
+        uint32_t numServerCheckpoints{};
+        syncProtocol.RecvValue(ConnectionType::Client, numServerCheckpoints);
+        std::optional<uint32_t> firstMismatch;
+        for (uint32_t i = 0; i < numServerCheckpoints; ++i) {
+            uint32_t serverCheckpoint{};
+            syncProtocol.RecvValue(ConnectionType::Client, serverCheckpoint);
+            if (!firstMismatch && (i >= numCheckpoints || checkpoints[i] != serverCheckpoint))
+                firstMismatch = i;
+        }
+        if (!firstMismatch)
+            firstMismatch = std::min(numCheckpoints, numServerCheckpoints);
+
+        // Instructions covered by the first checkpoint that differs. The last checkpoint may cover
+        // fewer instructions, or none if the server executed more of them.
+        uint32_t numServerHashes{};
+        syncProtocol.RecvValue(ConnectionType::Client, numServerHashes);
+        uint32_t first = 0;
+        uint32_t end = std::min(numHashes, numServerHashes);
+        if (m_hashGranularity != InstructionHasher::FrameGranularity) {
+            const auto granularity = static_cast<uint32_t>(m_hashGranularity);
+            first = std::min(*firstMismatch * granularity, end);
+            end = std::min(first + granularity, end);
+        }
+
+        int numQueries = 0;
+        while (first < end) {
+            const uint32_t mid = first + (end - first) / 2;
+            syncProtocol.SendValue(ConnectionType::Client, mid);
+            uint32_t serverHash{};
+            syncProtocol.RecvValue(ConnectionType::Client, serverHash);
+            ++numQueries;
+            if (serverHash == instructionHashes[mid]) {
+                first = mid + 1;
+            } else {
+                end = mid;
+            }
+        }
+        syncProtocol.SendValue(ConnectionType::Client, NoIndex);
+
+        const uint32_t mismatchIndex = first;
+        syncProtocol.SendValue(ConnectionType::Client, mismatchIndex);
+        bool hasServerTraceInfo{};
+        syncProtocol.RecvValue(ConnectionType::Client, hasServerTraceInfo);
+        InstructionTraceInfo serverTraceInfo;
+        if (hasServerTraceInfo) {
+            syncProtocol.RecvValue(ConnectionType::Client, serverTraceInfo);
+            // Points into the server's op code tables
+            serverTraceInfo.instruction = DecodeInstruction(serverTraceInfo.instruction.opBytes);
+        }
+
+        Errorf("Instruction hash mismatch at instruction %u of last %d instructions (found in %d "
+               "queries)\n",
+               mismatchIndex, numInstructionsExecutedThisFrame, numQueries);
+        if (hasServerTraceInfo) {
+            Printf("Server:\n");
+            PrintOp(serverTraceInfo, m_symbolTable);
+        }
+        if (mismatchIndex < frameTrace.size()) {
+            Printf("Client:\n");
+            PrintOp(frameTrace[mismatchIndex], m_symbolTable);
+        }
+    }
 }
 
 bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents& emuEvents,
@@ -814,6 +481,15 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
 
     int numInstructionsExecutedThisFrame = 0;
 
+    // Instructions are only hashed in sync mode, to compare with the other instance
+    if (m_traceEnabled) {
+        auto& traceCapture = GetTraceCapture();
+        if (traceCapture.HashEnabled() == syncProtocol.IsStandalone()) {
+            traceCapture.Flush();
+            traceCapture.SetHashEnabled(!syncProtocol.IsStandalone());
+        }
+    }
+
     auto PrintOp = [&](const InstructionTraceInfo& traceInfo) {
         if (m_traceEnabled) {
             ::PrintOp(traceInfo, m_symbolTable);
@@ -821,9 +497,10 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
     };
 
     auto PrintLastOp = [&] {
-        if (m_traceEnabled) {
+        if (m_traceEnabled && m_traceCapture) {
+            m_traceCapture->Flush();
             InstructionTraceInfo traceInfo;
-            if (g_instructionTraceBuffer.PeekBack(traceInfo)) {
+            if (m_traceCapture->History().PeekBack(traceInfo)) {
                 PrintOp(traceInfo);
             }
         }
@@ -833,10 +510,19 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
         try {
             InstructionTraceInfo traceInfo;
             if (m_traceEnabled) {
-                g_currTraceInfo = &traceInfo;
+                m_currTraceInfo = &traceInfo;
                 PreOpWriteTraceInfo(traceInfo, m_cpu->Registers(), *m_memoryBus);
             }
 
+            CpuRegisters preOpCpuRegisters;
+            uint8_t opCodeByte = 0;
+            if (m_hotSpotProfiler) {
+                preOpCpuRegisters = m_cpu->Registers();
+                m_memoryBus->SetCallbacksEnabled(false);
+                opCodeByte = m_memoryBus->Read(preOpCpuRegisters.PC);
+                m_memoryBus->SetCallbacksEnabled(true);
+            }
+
             // HACK: init to non-zero so that if an exception is thrown when executing instruction,
             // we end up collecting the last instruction in our trace - see "if (cpuCycles == 0)"
             // check in onExit lambda below. @TODO: fix this!
@@ -850,17 +536,14 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
                     // If the CPU didn't do anything (e.g. waiting for interrupts), we have nothing
                     // to log or hash
                     if (cpuCycles == 0) {
-                        g_currTraceInfo = nullptr;
+                        m_currTraceInfo = nullptr;
                         return;
                     }
 
+                    // Stored, written to file and hashed on the trace capture thread
                     PostOpWriteTraceInfo(traceInfo, m_cpu->Registers(), cpuCycles);
-                    g_instructionTraceBuffer.PushBackMoveFront(traceInfo);
-                    g_currTraceInfo = nullptr;
-
-                    // Compute running hash of instruction trace
-                    if (!syncProtocol.IsStandalone())
-                        m_instructionHash = HashInstructionTraceInfo(m_instructionHash, traceInfo);
+                    GetTraceCapture().Push(traceInfo);
+                    m_currTraceInfo = nullptr;
 
                     ++numInstructionsExecutedThisFrame;
                 }
@@ -871,6 +554,11 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
             if (cpuCycles > 0)
                 ++m_instructionCount;
 
+            if (m_hotSpotProfiler) {
+                m_hotSpotProfiler->OnInstruction(preOpCpuRegisters, m_cpu->Registers(),
+                                                 opCodeByte, cpuCycles);
+            }
+
             cycles_t effectiveCycles = cpuCycles == 0 ? 10 : cpuCycles;
 
             m_via->Update(effectiveCycles, input, renderContext, audioContext);
@@ -887,6 +575,33 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
         return static_cast<cycles_t>(0);
     };
 
+    // Via updates are deferred while executing a block, and caught up on whenever a device is
+    // accessed, so that Via sees the exact same sequence of cycles as with ExecuteInstruction.
+    cycles_t blockCycles = 0;
+    cycles_t blockCyclesSynced = 0;
+    auto SyncViaWithBlock = [&] {
+        if (blockCycles > blockCyclesSynced) {
+            m_via->Update(blockCycles - blockCyclesSynced, input, renderContext, audioContext);
+            blockCyclesSynced = blockCycles;
+        }
+    };
+
+    auto ExecuteBlock = [&] {
+        blockCycles = 0;
+        blockCyclesSynced = 0;
+        try {
+            m_instructionCount += m_cpu->ExecuteBlock(m_cpuCyclesLeft, blockCycles);
+        } catch (std::exception& ex) {
+            Printf("Exception caught:\n%s\n", ex.what());
+            BreakIntoDebugger();
+        } catch (...) {
+            Printf("Unknown exception caught\n");
+            BreakIntoDebugger();
+        }
+        SyncViaWithBlock();
+        return blockCycles;
+    };
+
     for (auto& event : emuEvents) {
         if (std::holds_alternative<EmuEvent::BreakIntoDebugger>(event.type)) {
             BreakIntoDebugger();
@@ -958,8 +673,7 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
         } else if (tokens[0] == "until" || tokens[0] == "u") {
             if (tokens.size() > 1) {
                 uint16_t address = StringToIntegral<uint16_t>(tokens[1]);
-                auto bp = m_breakpoints.Add(Breakpoint::Type::Instruction, address);
-                bp->autoDelete = true;
+                m_breakpoints.Add(Breakpoint::Type::Instruction, address, true);
                 ResumeFromDebugger();
             } else {
                 validCommand = false;
@@ -1006,8 +720,7 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
             validCommand = false;
             if (tokens.size() > 1) {
                 size_t breakpointIndex = std::stoi(tokens[1]);
-                if (auto bp = m_breakpoints.GetAtIndex(breakpointIndex)) {
-                    bp->enabled = true;
+                if (auto bp = m_breakpoints.SetEnabledAtIndex(breakpointIndex, true)) {
                     Printf("Enabled breakpoint %d at $%04x\n", breakpointIndex, bp->address);
                     validCommand = true;
                 } else {
@@ -1019,8 +732,7 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
             validCommand = false;
             if (tokens.size() > 1) {
                 size_t breakpointIndex = std::stoi(tokens[1]);
-                if (auto bp = m_breakpoints.GetAtIndex(breakpointIndex)) {
-                    bp->enabled = false;
+                if (auto bp = m_breakpoints.SetEnabledAtIndex(breakpointIndex, false)) {
                     Printf("Disabled breakpoint %d at $%04x\n", breakpointIndex, bp->address);
                     validCommand = true;
                 } else {
@@ -1088,6 +800,9 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
                 } else if (tokens[1] == "trace") {
                     m_traceEnabled = !m_traceEnabled;
                     Printf("Trace %s\n", m_traceEnabled ? "enabled" : "disabled");
+                } else if (tokens[1] == "blocks") {
+                    m_blockExecutionEnabled = !m_blockExecutionEnabled;
+                    Printf("Block execution %s\n", m_blockExecutionEnabled ? "enabled" : "disabled");
                 }
             } else {
                 validCommand = false;
@@ -1110,6 +825,66 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
                 validCommand = false;
             }
 
+        } else if (tokens[0] == "profile") {
+            auto profile = m_cpu->Profile();
+            if (tokens.size() > 1 && tokens[1] == "on") {
+                const int sampleInterval =
+                    tokens.size() > 2 ? StringToIntegral<int>(tokens[2]) : 0;
+                m_cpu->SetProfilingEnabled(true, sampleInterval);
+                Printf("Profiling enabled\n");
+            } else if (tokens.size() > 1 && tokens[1] == "off") {
+                m_cpu->SetProfilingEnabled(false);
+                Printf("Profiling disabled\n");
+            } else if (!profile) {
+                Printf("Profiling is not enabled\n");
+            } else if (tokens.size() > 1 && tokens[1] == "reset") {
+                profile->Reset();
+            } else if (tokens.size() > 1 && tokens[1] == "print") {
+                profile->Print(tokens.size() > 2 ? StringToIntegral<size_t>(tokens[2]) : 20);
+            } else if (tokens.size() > 2 && tokens[1] == "csv") {
+                if (profile->WriteCsv(tokens[2].c_str()))
+                    Printf("Wrote profile to %s\n", tokens[2].c_str());
+                else
+                    Printf("Failed to create profile file\n");
+            } else {
+                validCommand = false;
+            }
+
+        } else if (tokens[0] == "hotspot") {
+            if (tokens.size() > 1 && tokens[1] == "on") {
+                SetHotSpotProfilingEnabled(true);
+                Printf("Hot-spot profiling enabled\n");
+            } else if (tokens.size() > 1 && tokens[1] == "off") {
+                SetHotSpotProfilingEnabled(false);
+                Printf("Hot-spot profiling disabled\n");
+            } else if (!m_hotSpotProfiler) {
+                Printf("Hot-spot profiling is not enabled\n");
+            } else if (tokens.size() > 1 && tokens[1] == "reset") {
+                m_hotSpotProfiler->Reset();
+            } else if (tokens.size() > 1 && tokens[1] == "print") {
+                m_hotSpotProfiler->Print(tokens.size() > 2 ? StringToIntegral<size_t>(tokens[2])
+                                                           : 20);
+            } else if (tokens.size() > 2 && tokens[1] == "folded") {
+                if (m_hotSpotProfiler->WriteFoldedStacks(tokens[2].c_str()))
+                    Printf("Wrote folded stacks to %s\n", tokens[2].c_str());
+                else
+                    Printf("Failed to create folded stacks file\n");
+            } else {
+                validCommand = false;
+            }
+
+        } else if (tokens[0] == "stream") {
+            if (tokens.size() > 1 && tokens[1] == "off") {
+                StopTraceFile();
+            } else if (tokens.size() > 1) {
+                if (StartTraceFile(tokens[1].c_str()))
+                    Printf("Streaming trace to %s\n", tokens[1].c_str());
+                else
+                    Printf("Failed to create trace file\n");
+            } else {
+                validCommand = false;
+            }
+
         } else if (tokens[0] == "trace" || tokens[0] == "t") {
             size_t numLines = 10;
             const char* outFileName = nullptr;
@@ -1152,7 +927,9 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
                 });
 
                 std::vector<InstructionTraceInfo> buffer(numLines);
-                auto numInstructions = g_instructionTraceBuffer.PeekBack(buffer.data(), numLines);
+                auto& traceCapture = GetTraceCapture();
+                traceCapture.Flush();
+                auto numInstructions = traceCapture.History().PeekBack(buffer.data(), numLines);
                 buffer.resize(numInstructions);
                 for (auto& traceInfo : buffer) {
                     PrintOp(traceInfo);
@@ -1170,24 +947,55 @@ bool Debugger::FrameUpdate(double frameTime, const Input& input, const EmuEvents
         } else {
             Printf("Invalid command: %s\n", inputCommand.c_str());
         }
+
+        // Command may have changed watchpoints or tracing
+        UpdateMemoryBusCallbacks();
     } else { // Not broken into debugger (running)
 
         const double cpuHz = 6'000'000.0 / 4.0; // Frequency of the CPU (cycles/second)
         const double cpuCyclesThisFrame = cpuHz * frameTime;
 
+        // Breakpoints only change while broken into the debugger, so the per-instruction check is
+        // skipped entirely when there are none
+        const bool checkInstructionBreakpoints = m_breakpoints.HasInstructionBreakpoints();
+
+        // Blocks skip per-instruction breakpoint checks and tracing
+        const bool executeBlocks = m_blockExecutionEnabled && !m_traceEnabled &&
+                                   !m_hotSpotProfiler && !m_numInstructionsToExecute &&
+                                   !checkInstructionBreakpoints;
+        if (executeBlocks) {
+            // Only captures a reference, which std::function stores without allocating
+            m_memoryBus->SetDeviceAccessCallback([&SyncViaWithBlock] { SyncViaWithBlock(); });
+        }
+        auto onExit = MakeScopedExit([&] {
+            if (executeBlocks)
+                m_memoryBus->SetDeviceAccessCallback({});
+        });
+
         // Execute as many instructions that can fit in this time slice (plus one more at most)
         m_cpuCyclesLeft += cpuCyclesThisFrame;
         while (m_cpuCyclesLeft > 0) {
-            if (auto bp = m_breakpoints.Get(m_cpu->Registers().PC)) {
-                if (bp->type == Breakpoint::Type::Instruction) {
-                    if (bp->autoDelete) {
-                        m_breakpoints.Remove(m_cpu->Registers().PC);
-                        BreakIntoDebugger();
-                    } else if (bp->enabled) {
-                        Printf("Breakpoint hit at %04x\n", bp->address);
-                        BreakIntoDebugger();
+            if (executeBlocks) {
+                if (const cycles_t elapsedCycles = ExecuteBlock()) {
+                    m_cpuCyclesTotal += elapsedCycles;
+                    m_cpuCyclesLeft -= elapsedCycles;
+                    if (m_breakIntoDebugger) {
+                        m_cpuCyclesLeft = 0;
+                        break;
                     }
+                    continue;
+                }
+            }
+
+            if (checkInstructionBreakpoints &&
+                m_breakpoints.BreaksOnInstruction(m_cpu->Registers().PC)) {
+                const uint16_t pc = m_cpu->Registers().PC;
+                if (m_breakpoints.Get(pc)->autoDelete) {
+                    m_breakpoints.Remove(pc);
+                } else {
+                    Printf("Breakpoint hit at %04x\n", pc);
                 }
+                BreakIntoDebugger();
             }
 
             if (m_breakIntoDebugger) {
@@ -3,7 +3,9 @@
 #include "Base.h"
 #include "Breakpoints.h"
 #include "EngineClient.h"
+#include "InstructionHasher.h"
 #include <map>
+#include <memory>
 #include <optional>
 #include <queue>
 #include <string>
@@ -12,27 +14,66 @@ class MemoryBus;
 class Cpu;
 class Via;
 class SyncProtocol;
+class Serializer;
+class HotSpotProfiler;
+class TraceCapture;
 
 class Debugger {
 public:
+    Debugger();
+    ~Debugger();
+
     void Init(MemoryBus& memoryBus, Cpu& cpu, Via& via);
     void Reset();
     bool FrameUpdate(double frameTime, const Input& input, const EmuEvents& emuEvents,
                      RenderContext& renderContext, AudioContext& audioContext,
                      SyncProtocol& syncProtocol);
 
+    // Instruction tracing is enabled by default, but costs a memory bus callback per access
+    void SetTraceEnabled(bool enabled);
+
+    // Executes runs of pre-decoded ROM instructions as blocks, with a single Via update per block,
+    // whenever tracing, breakpoints and instruction stepping don't need per-instruction control
+    void SetBlockExecutionEnabled(bool enabled);
+
+    // Streams every traced instruction to a compact binary trace file, written on a background
+    // thread, until stopped. Enables tracing. Returns false if the file can't be created.
+    bool StartTraceFile(const char* file);
+    void StopTraceFile();
+
+    // How instructions are hashed in sync mode, and how many instructions each checkpoint covers
+    // (InstructionHasher::FrameGranularity for one per frame). On a mismatch, the checkpoints are
+    // compared to report the first range of instructions that differs.
+    void SetInstructionHashing(InstructionHasher::Mode mode, size_t granularity);
+
+    // Attributes cycles to guest code addresses and call stacks, named through the symbol table
+    // (which includes the BIOS routines), discarding any previous profile. Blocks aren't executed
+    // while enabled, as every instruction must be seen.
+    void SetHotSpotProfilingEnabled(bool enabled);
+
+    // Null if hot-spot profiling is disabled
+    HotSpotProfiler* HotSpotProfile();
+
+    // Only the emulation state kept here (cycle counts), not breakpoints or other debugging state
+    void Serialize(Serializer& s);
+
     using SymbolTable = std::multimap<uint16_t, std::string>;
 
 private:
     void BreakIntoDebugger();
     void ResumeFromDebugger();
+    void UpdateMemoryBusCallbacks();
     void SyncInstructionHash(SyncProtocol& syncProtocol, int numInstructionsExecutedThisFrame);
+    void FindInstructionHashMismatch(SyncProtocol& syncProtocol,
+                                     int numInstructionsExecutedThisFrame);
+    TraceCapture& GetTraceCapture();
 
     MemoryBus* m_memoryBus = nullptr;
     Cpu* m_cpu = nullptr;
     Via* m_via = nullptr;
     bool m_breakIntoDebugger = false;
     bool m_traceEnabled = false;
+    bool m_blockExecutionEnabled = false;
     bool m_colorEnabled = false;
     std::queue<std::string> m_pendingCommands;
     uint64_t m_instructionCount = 0;
@@ -42,5 +83,9 @@ private:
     SymbolTable m_symbolTable; // Address to symbol name
     cycles_t m_cpuCyclesTotal = 0;
     double m_cpuCyclesLeft = 0;
-    uint32_t m_instructionHash = 0;
+    std::unique_ptr<HotSpotProfiler> m_hotSpotProfiler;
+    std::unique_ptr<TraceCapture> m_traceCapture;
+    InstructionTraceInfo* m_currTraceInfo = nullptr; // Memory accesses of the current instruction
+    InstructionHasher::Mode m_hashMode = InstructionHasher::Mode::Fast;
+    size_t m_hashGranularity = InstructionHasher::FrameGranularity;
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "Serializer.h"
 
 // A simple value container on which we can assign values, but that value will only be returned
 // after an input number of cycles.
@@ -19,16 +20,26 @@ public:
     }
 
     void Update(cycles_t cycles) {
-        (void)cycles;
-        assert(cycles == 1);
-        if (m_cyclesLeft > 0 && --m_cyclesLeft == 0) {
+        if (m_cyclesLeft == 0)
+            return;
+
+        if (cycles >= m_cyclesLeft) {
+            m_cyclesLeft = 0;
             m_value = m_nextValue;
+        } else {
+            m_cyclesLeft -= cycles;
         }
     }
 
+    // Cycles until the last assigned value is returned, or 0 if it already is
+    cycles_t CyclesLeft() const { return m_cyclesLeft; }
+
     const T& Value() const { return m_value; }
     operator const T&() const { return Value(); }
 
+    // CyclesToUpdateValue is configuration, not state
+    void Serialize(Serializer& s) { s.Serialize(m_cyclesLeft, m_nextValue, m_value); }
+
 private:
     cycles_t m_cyclesLeft{};
     T m_nextValue;
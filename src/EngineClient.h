@@ -52,8 +52,19 @@ public:
     struct OpenRomFile {
         fs::path path{}; // If not set, use open file dialog
     };
+    struct SaveState {
+        fs::path path{}; // If not set, use quick save slot
+    };
+    struct LoadState {
+        fs::path path{}; // If not set, use quick save slot
+    };
+    // Step back this many frames, then emulate and display one frame from there, even if paused
+    struct Rewind {
+        int frames = 1;
+    };
 
-    using Type = std::variant<BreakIntoDebugger, Reset, OpenRomFile>;
+    using Type =
+        std::variant<BreakIntoDebugger, Reset, OpenRomFile, SaveState, LoadState, Rewind>;
     Type type;
 };
 using EmuEvents = std::vector<EmuEvent>;
@@ -63,6 +74,8 @@ struct EmuContext {
     std::reference_wrapper<Options> options;
 };
 
+// Engines keep the render and audio contexts across frames, and clear them once consumed, so that
+// they keep their storage and steady-state frames don't allocate
 struct RenderContext {
     std::vector<Line> lines; // Lines to draw this frame
 };
@@ -77,6 +90,14 @@ struct AudioContext {
 
 class IEngineClient {
 public:
+    // Called before Init by engines that let the user rewind (EmuEvent::Rewind). Rewinding keeps a
+    // save-state of every frame, which costs time and memory that other engines don't need to pay.
+    virtual void SetRewindEnabled(bool enabled) = 0;
+
+    // Called before Init by engines that can't fall back to Mine Storm when the rom passed on the
+    // command line fails to load (e.g. batch runs), which makes Init fail instead.
+    virtual void SetRomRequired(bool required) = 0;
+
     virtual bool Init(int argc, char** argv) = 0;
     virtual bool FrameUpdate(double frameTime, const Input& input, const EmuContext& emuContext,
                              RenderContext& renderContext, AudioContext& audioContext) = 0;
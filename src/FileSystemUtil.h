@@ -1,5 +1,6 @@
 #pragma once
 
+#include "ConsoleOutput.h"
 #include "FileSystem.h"
 
 namespace FileSystemUtil {
@@ -22,4 +23,30 @@ namespace FileSystemUtil {
     private:
         fs::path m_lastDir;
     };
+
+    inline bool FindAndSetRootPath(fs::path exePath) {
+        // Look for bios file in current directory and up parent dirs
+        // and set current working directory to the one found.
+        const char* biosRomFile = "bios_rom.bin";
+
+        auto currDir = exePath.remove_filename();
+
+        do {
+            auto path = currDir / biosRomFile;
+
+            if (fs::exists(currDir / biosRomFile)) {
+                fs::current_path(currDir);
+                Printf("Root path set to: %s\n", fs::current_path().string().c_str());
+                return true;
+            }
+            // Stop at the root, which is its own parent
+            auto parentDir = currDir.parent_path();
+            if (parentDir == currDir)
+                break;
+            currDir = parentDir;
+        } while (!currDir.empty());
+
+        Errorf("Bios rom file not found: %s\n", biosRomFile);
+        return false;
+    }
 } // namespace FileSystemUtil
@@ -0,0 +1,79 @@
+#include "FrameHash.h"
+#include "ConsoleOutput.h"
+#include "InstructionHasher.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    uint32_t CanonicalFloatBits(float value) {
+        if (std::isnan(value))
+            return 0x7fc00000;
+        if (value == 0.f)
+            return 0;
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    uint8_t* PutFloat(uint8_t* out, float value) {
+        const uint32_t bits = CanonicalFloatBits(value);
+        out[0] = static_cast<uint8_t>(bits);
+        out[1] = static_cast<uint8_t>(bits >> 8);
+        out[2] = static_cast<uint8_t>(bits >> 16);
+        out[3] = static_cast<uint8_t>(bits >> 24);
+        return out + 4;
+    }
+
+    const size_t PackedLineSize = 5 * 4;
+} // namespace
+
+FrameHash FrameHasher::Hash(const RenderContext& renderContext,
+                            const AudioContext& audioContext) {
+    FrameHash frameHash;
+    const auto& lines = renderContext.lines;
+    const auto& samples = audioContext.samples;
+
+    m_buffer.resize(std::max(lines.size() * PackedLineSize, samples.size() * 4));
+
+    uint8_t* out = m_buffer.data();
+    for (auto& line : lines) {
+        out = PutFloat(out, line.p0.x);
+        out = PutFloat(out, line.p0.y);
+        out = PutFloat(out, line.p1.x);
+        out = PutFloat(out, line.p1.y);
+        out = PutFloat(out, line.brightness);
+    }
+    frameHash.numLines = static_cast<uint32_t>(lines.size());
+    frameHash.linesHash = Crc32c(0, m_buffer.data(), out - m_buffer.data());
+
+    out = m_buffer.data();
+    for (float sample : samples)
+        out = PutFloat(out, sample);
+    frameHash.numSamples = static_cast<uint32_t>(samples.size());
+    frameHash.samplesHash = Crc32c(0, m_buffer.data(), out - m_buffer.data());
+
+    return frameHash;
+}
+
+bool FrameHashFile::OpenWrite(const char* file) {
+    if (!m_stream.Open(file, "wb") || m_stream.WriteValue(Header{}) != 1) {
+        Errorf("Failed to open frame hash file for writing: %s\n", file);
+        return false;
+    }
+    return true;
+}
+
+bool FrameHashFile::OpenRead(const char* file) {
+    Header header;
+    if (!m_stream.Open(file, "rb") || !m_stream.ReadValue(header)) {
+        Errorf("Failed to open frame hash file: %s\n", file);
+        return false;
+    }
+    if (header.magic != Magic || header.version != Version) {
+        Errorf("Not a frame hash file, or unsupported version: %s\n", file);
+        m_stream.Close();
+        return false;
+    }
+    return true;
+}
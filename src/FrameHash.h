@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Base.h"
+#include "EngineClient.h"
+#include "Stream.h"
+#include <optional>
+#include <vector>
+
+// Hash of everything a frame outputs: the lines drawn and the audio samples produced
+struct FrameHash {
+    uint32_t numLines{};
+    uint32_t linesHash{};
+    uint32_t numSamples{};
+    uint32_t samplesHash{};
+
+    bool LinesMatch(const FrameHash& rhs) const {
+        return numLines == rhs.numLines && linesHash == rhs.linesHash;
+    }
+    bool SamplesMatch(const FrameHash& rhs) const {
+        return numSamples == rhs.numSamples && samplesHash == rhs.samplesHash;
+    }
+    bool operator==(const FrameHash& rhs) const { return LinesMatch(rhs) && SamplesMatch(rhs); }
+    bool operator!=(const FrameHash& rhs) const { return !(*this == rhs); }
+};
+
+// Hashes frames for bit-exact regression checks. Lines and samples are canonicalised first, so
+// that the hash only depends on their values, not on how they're laid out in memory: floats are
+// packed little-endian, -0 is hashed as 0, and every NaN as the same quiet NaN.
+class FrameHasher {
+public:
+    FrameHash Hash(const RenderContext& renderContext, const AudioContext& audioContext);
+
+private:
+    std::vector<uint8_t> m_buffer; // Canonical bytes, reused from frame to frame
+};
+
+// Stream of frame hashes, written by one run and compared against by later ones.
+//
+// File format: Header, followed by a FrameHash for every frame, unpadded.
+class FrameHashFile {
+public:
+    struct Header {
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+    };
+
+    bool OpenWrite(const char* file);
+    bool OpenRead(const char* file);
+    void Close() { m_stream.Close(); }
+
+    void Write(const FrameHash& frameHash) { m_stream.WriteValue(frameHash); }
+
+    // Returns nullopt once all frames have been read
+    std::optional<FrameHash> Read() {
+        FrameHash frameHash;
+        if (!m_stream.ReadValue(frameHash))
+            return {};
+        return frameHash;
+    }
+
+private:
+    static constexpr uint32_t Magic = 0x48465856; // "VXFH"
+    static constexpr uint32_t Version = 1;
+
+    FileStream m_stream;
+};
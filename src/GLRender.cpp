@@ -88,13 +88,15 @@ namespace {
         float brightness{};
     };
 
-    std::vector<VertexData> CreateQuadVertexArray(const std::vector<Line>& lines, float lineWidth,
-                                                  float scaleX, float scaleY) {
+    // Vertex arrays are filled in place, and keep their storage from one frame to the next
+    void CreateQuadVertexArray(const std::vector<Line>& lines, float lineWidth, float scaleX,
+                               float scaleY, std::vector<VertexData>& result) {
         auto AlmostEqual = [](float a, float b, float epsilon = 0.01f) {
             return abs(a - b) <= epsilon;
         };
 
-        std::vector<VertexData> result;
+        result.clear();
+        result.reserve(lines.size() * 6);
 
         const float MinPixelDist = 1.f;
 
@@ -143,16 +145,17 @@ namespace {
                 result.insert(result.end(), {a, b, c, c, d, a});
             }
         }
-        return result;
     }
 
-    std::tuple<std::vector<VertexData>, std::vector<VertexData>>
-    CreateLineAndPointVertexArrays(const std::vector<Line>& lines, float scaleX, float scaleY) {
+    void CreateLineAndPointVertexArrays(const std::vector<Line>& lines, float scaleX, float scaleY,
+                                        std::vector<VertexData>& lineVA,
+                                        std::vector<VertexData>& pointVA) {
         auto AlmostEqual = [](float a, float b, float epsilon = 0.01f) {
             return abs(a - b) <= epsilon;
         };
 
-        std::vector<VertexData> lineVA, pointVA;
+        lineVA.clear();
+        pointVA.clear();
 
         for (auto& line : lines) {
             glm::vec2 p0{line.p0.x * scaleX, line.p0.y * scaleY};
@@ -165,8 +168,6 @@ namespace {
                 lineVA.push_back({p1, line.brightness});
             }
         }
-
-        return {lineVA, pointVA};
     }
 
     std::array<glm::vec3, 6> MakeClipSpaceQuad(float scaleX = 1.f, float scaleY = 1.f) {
@@ -357,9 +358,6 @@ namespace {
         void Draw(const Texture& inputTexture, const Texture& outputTexture, float frameTime) {
             ScopedDebugGroup sdg("DarkenTexturePass");
 
-            IMGUI_CALL_IF(GLRenderImGui, Debug,
-                          ImGui::SliderFloat("DarkenSpeedScale", &DarkenSpeedScale, 0.0f, 10.0f));
-
             SetFrameBufferTexture(*g_textureFB, outputTexture.Id());
             SetViewportToTextureDims(outputTexture);
             // No need to clear as we write every pixel
@@ -385,9 +383,6 @@ namespace {
                   const Texture& outputTexture) {
             ScopedDebugGroup sdg("GlowPass");
 
-            IMGUI_CALL_IF(GLRenderImGui, Debug,
-                          ImGui::SliderFloat("GlowRadius", &GlowRadius, 0.0f, 5.0f));
-
             GlowInDirection(inputTexture, tempTexture, {1.f, 0.f});
             GlowInDirection(tempTexture, outputTexture, {0.f, 1.f});
         };
@@ -469,9 +464,6 @@ namespace {
         void Draw(const Texture& inputCrtTexture, const Texture& inputOverlayTexture) {
             ScopedDebugGroup sdg("RenderToScreenPass");
 
-            IMGUI_CALL_IF(GLRenderImGui, Debug,
-                          ImGui::SliderFloat("OverlayAlpha", &OverlayAlpha, 0.0f, 1.0f));
-
             GLUtil::BindFrameBuffer(0);
             SetViewport(g_screenViewport);
             // No need to clear as we write every pixel
@@ -636,7 +628,7 @@ namespace GLRender {
         return true;
     }
 
-    void RenderScene(double frameTime, const RenderContext& renderContext) {
+    void UpdateImGui() {
         IMGUI_CALL(Debug, ImGui::Checkbox("<<< GLRender >>>", &GLRenderImGui));
 
         // Force resize on crt scale change
@@ -663,6 +655,27 @@ namespace GLRender {
             }
         }
 
+        IMGUI_CALL_IF(GLRenderImGui, Debug, ImGui::Checkbox("ThickBaseLines", &ThickBaseLines));
+        if (ThickBaseLines) {
+            IMGUI_CALL_IF(GLRenderImGui, Debug,
+                          ImGui::SliderFloat("LineWidthNormal", &LineWidthNormal, 0.1f, 3.0f));
+        }
+        IMGUI_CALL_IF(GLRenderImGui, Debug,
+                      ImGui::SliderFloat("DarkenSpeedScale", &DarkenSpeedScale, 0.0f, 10.0f));
+
+        IMGUI_CALL_IF(GLRenderImGui, Debug, ImGui::Checkbox("EnableBlur", &EnableBlur));
+        if (EnableBlur) {
+            IMGUI_CALL_IF(GLRenderImGui, Debug,
+                          ImGui::SliderFloat("LineWidthGlow", &LineWidthGlow, 0.1f, 2.0f));
+            IMGUI_CALL_IF(GLRenderImGui, Debug,
+                          ImGui::SliderFloat("GlowRadius", &GlowRadius, 0.0f, 5.0f));
+        }
+
+        IMGUI_CALL_IF(GLRenderImGui, Debug,
+                      ImGui::SliderFloat("OverlayAlpha", &OverlayAlpha, 0.0f, 1.0f));
+    }
+
+    void RenderScene(double frameTime, const RenderContext& renderContext) {
         if (frameTime > 0)
             g_vectorsTexture0Index = (g_vectorsTexture0Index + 1) % 2;
 
@@ -684,29 +697,23 @@ namespace GLRender {
         const float lineWidthScale = lineScaleX;
 
         // Render normal lines and points, and darken
-        IMGUI_CALL_IF(GLRenderImGui, Debug, ImGui::Checkbox("ThickBaseLines", &ThickBaseLines));
         if (!ThickBaseLines) {
-            std::tie(g_lineVA, g_pointVA) =
-                CreateLineAndPointVertexArrays(renderContext.lines, lineScaleX, lineScaleY);
+            CreateLineAndPointVertexArrays(renderContext.lines, lineScaleX, lineScaleY, g_lineVA,
+                                           g_pointVA);
             g_drawVectorsPass.Draw(g_lineVA, GL_LINES, g_pointVA, GL_POINTS, currVectorsTexture0);
         } else {
-            IMGUI_CALL_IF(GLRenderImGui, Debug,
-                          ImGui::SliderFloat("LineWidthNormal", &LineWidthNormal, 0.1f, 3.0f));
-            g_quadVA = CreateQuadVertexArray(renderContext.lines, LineWidthNormal * lineWidthScale,
-                                             lineScaleX, lineScaleY);
+            CreateQuadVertexArray(renderContext.lines, LineWidthNormal * lineWidthScale, lineScaleX,
+                                  lineScaleY, g_quadVA);
             g_drawVectorsPass.Draw(g_quadVA, GL_TRIANGLES, {}, {}, currVectorsTexture0);
         }
         g_darkenTexturePass.Draw(currVectorsTexture0, currVectorsTexture1,
                                  static_cast<float>(frameTime));
 
-        IMGUI_CALL_IF(GLRenderImGui, Debug, ImGui::Checkbox("EnableBlur", &EnableBlur));
         if (EnableBlur) {
 
             // Render thicker lines for blurring, darken, and apply glow
-            IMGUI_CALL_IF(GLRenderImGui, Debug,
-                          ImGui::SliderFloat("LineWidthGlow", &LineWidthGlow, 0.1f, 2.0f));
-            g_quadVA = CreateQuadVertexArray(renderContext.lines, LineWidthGlow * lineWidthScale,
-                                             lineScaleX, lineScaleY);
+            CreateQuadVertexArray(renderContext.lines, LineWidthGlow * lineWidthScale, lineScaleX,
+                                  lineScaleY, g_quadVA);
             g_drawVectorsPass.Draw(g_quadVA, GL_TRIANGLES, {}, {}, currVectorsThickTexture0);
             g_darkenTexturePass.Draw(currVectorsThickTexture0, currVectorsThickTexture1,
                                      static_cast<float>(frameTime));
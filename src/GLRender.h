@@ -10,5 +10,8 @@ namespace GLRender {
     void Shutdown();
     void ResetOverlay(const char* file = nullptr);
     bool OnWindowResized(int windowWidth, int windowHeight);
+    // Shows the rendering tweakables in the debug window. Called once per host frame, as
+    // RenderScene may be called several times per host frame while fast-forwarding.
+    void UpdateImGui();
     void RenderScene(double frameTime, const RenderContext& renderContext);
 } // namespace GLRender
@@ -1,6 +1,15 @@
 #pragma once
 
 #include <array>
+
+#if defined(VECTREXY_HEADLESS)
+
+// Headless builds don't link against ImGui, so all ImGui calls compile away
+#define IMGUI_CALL(window, func) (void)0
+#define IMGUI_CALL_IF(condition, window, func) (void)0
+
+#else
+
 #include <imgui.h>
 
 namespace Gui {
@@ -35,3 +44,5 @@ namespace Gui {
     Gui::Internal::DoImguiCall(#window, Gui::Window::window, [&] { func; })
 
 } // namespace Gui
+
+#endif // defined(VECTREXY_HEADLESS)
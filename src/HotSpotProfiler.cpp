@@ -0,0 +1,205 @@
+#include "HotSpotProfiler.h"
+#include "ConsoleOutput.h"
+#include "Cpu.h"
+#include "Stream.h"
+#include <algorithm>
+
+namespace {
+    const int32_t RootAddress = -1;
+    const int32_t InterruptAddress = -2;
+
+    // Deeper calls are attributed to the deepest frame, which only happens if the stack is
+    // manipulated in ways we can't follow
+    const size_t MaxCallDepth = 256;
+
+    // IRQ and SWI push the entire register state
+    const uint16_t InterruptStackBytes = 12;
+
+    bool IsCallOp(uint8_t opCodeByte) {
+        switch (opCodeByte) {
+        case 0x17: // LBSR
+        case 0x8D: // BSR
+        case 0x9D: // JSR direct
+        case 0xAD: // JSR indexed
+        case 0xBD: // JSR extended
+            return true;
+        }
+        return false;
+    }
+
+    double Percent(uint64_t value, uint64_t total) {
+        return total > 0 ? 100.0 * value / total : 0.0;
+    }
+
+    struct Entry {
+        std::string name;
+        uint64_t selfCycles{};
+        uint64_t inclusiveCycles{};
+    };
+
+    void PrintEntries(std::vector<Entry>& entries, size_t maxEntries, uint64_t totalCycles,
+                      bool sortByInclusive) {
+        std::sort(entries.begin(), entries.end(), [sortByInclusive](auto& lhs, auto& rhs) {
+            return sortByInclusive ? lhs.inclusiveCycles > rhs.inclusiveCycles
+                                   : lhs.selfCycles > rhs.selfCycles;
+        });
+        Printf("%-24s %14s %7s %14s %7s\n", "", "self", "self%", "inclusive", "incl%");
+        for (size_t i = 0; i < std::min(maxEntries, entries.size()); ++i) {
+            auto& entry = entries[i];
+            Printf("%-24s %14llu %6.2f%% %14llu %6.2f%%\n", entry.name.c_str(),
+                   (unsigned long long)entry.selfCycles, Percent(entry.selfCycles, totalCycles),
+                   (unsigned long long)entry.inclusiveCycles,
+                   Percent(entry.inclusiveCycles, totalCycles));
+        }
+    }
+} // namespace
+
+HotSpotProfiler::HotSpotProfiler(const SymbolTable& symbolTable)
+    : m_symbolTable(symbolTable) {
+    Reset();
+}
+
+void HotSpotProfiler::Reset() {
+    m_nodes.clear();
+    m_nodes.push_back({RootAddress, 0});
+    m_frames.clear();
+    m_addressCycles.assign(0x10000, 0);
+    m_totalCycles = 0;
+}
+
+size_t HotSpotProfiler::Child(size_t parent, int32_t address) {
+    auto iter = m_nodes[parent].children.find(address);
+    if (iter != m_nodes[parent].children.end())
+        return iter->second;
+
+    const size_t child = m_nodes.size();
+    m_nodes.push_back({address, parent});
+    m_nodes[parent].children[address] = child;
+    return child;
+}
+
+void HotSpotProfiler::PushFrame(int32_t address, uint16_t returnS) {
+    if (m_frames.size() >= MaxCallDepth)
+        return;
+    const size_t parent = m_frames.empty() ? 0 : m_frames.back().node;
+    m_frames.push_back({Child(parent, address), returnS});
+}
+
+void HotSpotProfiler::OnInstruction(const CpuRegisters& before, const CpuRegisters& after,
+                                    uint8_t opCodeByte, cycles_t cycles) {
+    // Entering an interrupt sets the IRQ mask and pushes the registers, except when waking up from
+    // CWAI, which pushed them already. SWI is followed the same way as it also returns with RTI.
+    const bool interrupt =
+        !before.CC.InterruptMask && after.CC.InterruptMask &&
+        (static_cast<uint16_t>(before.S - after.S) == InterruptStackBytes ||
+         (cycles == 0 && before.PC != after.PC));
+    if (interrupt)
+        PushFrame(InterruptAddress, after.S + InterruptStackBytes);
+
+    if (cycles > 0) {
+        const size_t node = m_frames.empty() ? 0 : m_frames.back().node;
+        m_nodes[node].selfCycles += cycles;
+        m_addressCycles[before.PC] += cycles;
+        m_totalCycles += cycles;
+    }
+
+    if (interrupt)
+        return;
+
+    if (IsCallOp(opCodeByte)) {
+        PushFrame(after.PC, before.S);
+    } else {
+        // Returns, and anything else that unwinds the stack past the return address (e.g. a
+        // PULS PC or resetting S)
+        while (!m_frames.empty() && after.S >= m_frames.back().returnS)
+            m_frames.pop_back();
+    }
+}
+
+std::string HotSpotProfiler::FunctionName(int32_t address) const {
+    if (address == RootAddress)
+        return "[vectrex]";
+    if (address == InterruptAddress)
+        return "[interrupt]";
+    auto iter = m_symbolTable.find(static_cast<uint16_t>(address));
+    if (iter != m_symbolTable.end())
+        return iter->second;
+    return FormattedString<>("$%04x", address).Value();
+}
+
+std::string HotSpotProfiler::RangeName(uint16_t address) const {
+    auto iter = m_symbolTable.upper_bound(address);
+    if (iter == m_symbolTable.begin())
+        return "[no symbol]";
+    --iter;
+    return iter->second;
+}
+
+void HotSpotProfiler::Print(size_t maxEntries) const {
+    // Nodes are created after their parent, so inclusive cycles can be summed up in reverse order
+    std::vector<uint64_t> inclusiveCycles(m_nodes.size());
+    for (size_t i = m_nodes.size(); i-- > 0;) {
+        inclusiveCycles[i] += m_nodes[i].selfCycles;
+        if (i > 0)
+            inclusiveCycles[m_nodes[i].parent] += inclusiveCycles[i];
+    }
+
+    std::map<int32_t, Entry> functions;
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        auto& entry = functions[m_nodes[i].address];
+        entry.selfCycles += m_nodes[i].selfCycles;
+
+        // Count recursive calls only once, at the outermost call
+        bool recursive = false;
+        for (size_t p = i; p != 0 && !recursive;) {
+            p = m_nodes[p].parent;
+            recursive = m_nodes[p].address == m_nodes[i].address;
+        }
+        if (!recursive)
+            entry.inclusiveCycles += inclusiveCycles[i];
+    }
+
+    std::vector<Entry> entries;
+    for (auto& [address, entry] : functions) {
+        entries.push_back(entry);
+        entries.back().name = FunctionName(address);
+    }
+
+    Printf("Functions by self cycles (total %llu cycles)\n", (unsigned long long)m_totalCycles);
+    PrintEntries(entries, maxEntries, m_totalCycles, false);
+    Printf("\nFunctions by inclusive cycles\n");
+    PrintEntries(entries, maxEntries, m_totalCycles, true);
+
+    std::map<std::string, Entry> ranges;
+    for (uint32_t address = 0; address < m_addressCycles.size(); ++address) {
+        if (m_addressCycles[address] > 0) {
+            auto name = RangeName(static_cast<uint16_t>(address));
+            ranges[name].selfCycles += m_addressCycles[address];
+        }
+    }
+
+    entries.clear();
+    for (auto& [name, entry] : ranges) {
+        entries.push_back(entry);
+        entries.back().name = name;
+        entries.back().inclusiveCycles = entry.selfCycles;
+    }
+    Printf("\nAddress ranges by cycles (from each symbol up to the next)\n");
+    PrintEntries(entries, maxEntries, m_totalCycles, false);
+}
+
+bool HotSpotProfiler::WriteFoldedStacks(const char* file) const {
+    FileStream fs;
+    if (!fs.Open(file, "w"))
+        return false;
+
+    // Stack of each node, built from its parent's which always comes first
+    std::vector<std::string> stacks(m_nodes.size());
+    for (size_t i = 0; i < m_nodes.size(); ++i) {
+        auto name = FunctionName(m_nodes[i].address);
+        stacks[i] = i == 0 ? name : stacks[m_nodes[i].parent] + ";" + name;
+        if (m_nodes[i].selfCycles > 0)
+            fs.Printf("%s %llu\n", stacks[i].c_str(), (unsigned long long)m_nodes[i].selfCycles);
+    }
+    return true;
+}
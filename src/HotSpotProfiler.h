@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Base.h"
+#include <map>
+#include <string>
+#include <vector>
+
+class CpuRegisters;
+
+// Attributes the cycles of every executed instruction to its address, and to a call tree built by
+// following JSR/BSR calls and RTS/RTI returns on the hardware stack. Interrupts show up as an
+// "[interrupt]" frame in the tree. Addresses are named through the symbol table, which must outlive
+// the profiler.
+class HotSpotProfiler {
+public:
+    using SymbolTable = std::multimap<uint16_t, std::string>;
+
+    explicit HotSpotProfiler(const SymbolTable& symbolTable);
+
+    // Called after each instruction with the registers before and after it, and the first byte of
+    // the instruction at the previous PC. Instructions that took 0 cycles (waiting for interrupts)
+    // are only checked for entering an interrupt.
+    void OnInstruction(const CpuRegisters& before, const CpuRegisters& after, uint8_t opCodeByte,
+                       cycles_t cycles);
+
+    void Reset();
+
+    uint64_t TotalCycles() const { return m_totalCycles; }
+
+    // Prints the maxEntries functions with the most self and inclusive cycles, and the cycles spent
+    // in each range of addresses between consecutive symbols
+    void Print(size_t maxEntries) const;
+
+    // Writes the call tree as folded stacks ("root;caller;callee cycles" per line), the input
+    // format of flame graph tools
+    bool WriteFoldedStacks(const char* file) const;
+
+private:
+    struct Node {
+        int32_t address; // Entry point of the function, or one of the special addresses below
+        size_t parent;
+        uint64_t selfCycles{};
+        std::map<int32_t, size_t> children; // Address to node index
+    };
+
+    struct Frame {
+        size_t node;
+        uint16_t returnS; // The frame is popped once S is restored to at least this value
+    };
+
+    size_t Child(size_t parent, int32_t address);
+    void PushFrame(int32_t address, uint16_t returnS);
+    std::string FunctionName(int32_t address) const;
+    std::string RangeName(uint16_t address) const;
+
+    const SymbolTable& m_symbolTable;
+    std::vector<Node> m_nodes;
+    std::vector<Frame> m_frames;
+    std::vector<uint64_t> m_addressCycles; // Per instruction address
+    uint64_t m_totalCycles{};
+};
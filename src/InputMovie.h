@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Base.h"
+#include "ConsoleOutput.h"
+#include "EngineClient.h"
+#include "Stream.h"
+
+// Records the frame time and input of every frame to a file, or plays them back. Like lockstep
+// with the SyncProtocol, this relies on the emulator being deterministic, so a movie replays the
+// same session as long as it starts from the same rom and initial RAM contents. Only frame time and
+// input are recorded, so Vectrexy refuses events that otherwise change state (reset, loading a rom
+// or state, rewinding) while a movie is open.
+//
+// File format: Header, followed by frame time (double) and Input for every frame, unpadded.
+class InputMovie {
+public:
+    struct Header {
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        uint32_t romHash{};
+        uint32_t ramRandomized{}; // 0 if RAM was left cleared on reset, as in lockstep sessions
+        uint32_t ramSeed{};       // Passed to Ram::Randomize on reset, if ramRandomized
+    };
+
+    bool OpenRecord(const char* file, const Header& header) {
+        Close();
+        if (!m_stream.Open(file, "wb") || m_stream.WriteValue(header) != 1) {
+            Errorf("Failed to open movie file for recording: %s\n", file);
+            return false;
+        }
+        m_header = header;
+        m_recording = true;
+        return true;
+    }
+
+    bool OpenPlay(const char* file) {
+        Close();
+        Header header;
+        if (!m_stream.Open(file, "rb") || !m_stream.ReadValue(header)) {
+            Errorf("Failed to open movie file for playback: %s\n", file);
+            return false;
+        }
+        if (header.magic != Magic || header.version != Version) {
+            Errorf("Not a movie file, or unsupported version: %s\n", file);
+            m_stream.Close();
+            return false;
+        }
+        m_header = header;
+        m_playing = true;
+        return true;
+    }
+
+    void Close() {
+        m_stream.Close();
+        m_recording = m_playing = false;
+        m_numFrames = 0;
+    }
+
+    bool IsRecording() const { return m_recording; }
+    bool IsPlaying() const { return m_playing; }
+    const Header& GetHeader() const { return m_header; }
+    uint64_t NumFrames() const { return m_numFrames; }
+
+    void RecordFrame(double frameTime, const Input& input) {
+        ASSERT(m_recording);
+        m_stream.WriteValue(frameTime);
+        m_stream.WriteValue(input);
+        ++m_numFrames;
+    }
+
+    // Returns false once all frames have been played back
+    bool PlayFrame(double& frameTime, Input& input) {
+        ASSERT(m_playing);
+        if (!m_stream.ReadValue(frameTime) || !m_stream.ReadValue(input))
+            return false;
+        ++m_numFrames;
+        return true;
+    }
+
+private:
+    static constexpr uint32_t Magic = 0x564d5856; // "VXMV"
+    static constexpr uint32_t Version = 2;
+
+    FileStream m_stream;
+    Header m_header;
+    bool m_recording = false;
+    bool m_playing = false;
+    uint64_t m_numFrames = 0;
+};
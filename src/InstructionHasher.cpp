@@ -0,0 +1,143 @@
+#include "InstructionHasher.h"
+#include "InstructionTrace.h"
+#include <array>
+
+namespace {
+    // CRC-32C (iSCSI) polynomial in reversed bit order.
+    const uint32_t Crc32cPoly = 0x82f63b78;
+
+    // Tables for slicing-by-8: table[0] is the usual byte-at-a-time table, and table[k] advances
+    // the CRC of a byte followed by k zero bytes, so that 8 bytes are processed per step
+    using Crc32cTables = std::array<std::array<uint32_t, 256>, 8>;
+
+    constexpr Crc32cTables MakeCrc32cTables() {
+        Crc32cTables tables{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; ++k)
+                crc = crc & 1 ? (crc >> 1) ^ Crc32cPoly : crc >> 1;
+            tables[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (size_t t = 1; t < tables.size(); ++t) {
+                const uint32_t prev = tables[t - 1][i];
+                tables[t][i] = (prev >> 8) ^ tables[0][prev & 0xFF];
+            }
+        }
+        return tables;
+    }
+
+    constexpr Crc32cTables Tables = MakeCrc32cTables();
+
+    template <typename T>
+    uint32_t Crc32c(uint32_t crc, const T& value) {
+        return ::Crc32c(crc, &value, sizeof(value));
+    }
+
+    uint32_t HashInstructionTraceInfo(uint32_t currInstructionHash,
+                                      const InstructionTraceInfo& traceInfo) {
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.instruction.cpuOp->opCode);
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.instruction.cpuOp->addrMode);
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.instruction.page);
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.elapsedCycles);
+        for (size_t i = 0; i < traceInfo.numMemoryAccesses; ++i) {
+            currInstructionHash += Crc32c(currInstructionHash, traceInfo.memoryAccesses[i].address);
+            currInstructionHash += Crc32c(currInstructionHash, traceInfo.memoryAccesses[i].read);
+            currInstructionHash += Crc32c(currInstructionHash, traceInfo.memoryAccesses[i].value);
+        }
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.preOpCpuRegisters);
+        currInstructionHash += Crc32c(currInstructionHash, traceInfo.postOpCpuRegisters);
+        return currInstructionHash;
+    }
+
+    uint8_t* Put16(uint8_t* out, uint16_t value) {
+        out[0] = static_cast<uint8_t>(value & 0xFF);
+        out[1] = static_cast<uint8_t>(value >> 8);
+        return out + 2;
+    }
+
+    // Bytes appended per instruction, at most
+    const size_t MaxPackedSize =
+        6 + InstructionTraceInfo::MaxMemoryAccesses * 5 + sizeof(CpuRegisters);
+
+    // Packs the fields hashed in Legacy mode, except for the registers before the instruction,
+    // which are those after the previous one
+    void AppendToBatch(std::vector<uint8_t>& batch, const InstructionTraceInfo& traceInfo) {
+        const size_t size = batch.size();
+        batch.resize(size + MaxPackedSize);
+        uint8_t* out = batch.data() + size;
+
+        const auto& regs = traceInfo.postOpCpuRegisters;
+        *out++ = static_cast<uint8_t>(traceInfo.instruction.page);
+        *out++ = traceInfo.instruction.cpuOp->opCode;
+        out = Put16(out, static_cast<uint16_t>(traceInfo.elapsedCycles));
+        *out++ = static_cast<uint8_t>(traceInfo.numMemoryAccesses);
+        for (size_t i = 0; i < traceInfo.numMemoryAccesses; ++i) {
+            auto& ma = traceInfo.memoryAccesses[i];
+            out = Put16(out, ma.address);
+            out = Put16(out, ma.value);
+            *out++ = ma.read ? 1 : 0;
+        }
+        for (uint16_t value : {regs.X, regs.Y, regs.U, regs.S, regs.PC, regs.D})
+            out = Put16(out, value);
+        *out++ = regs.DP;
+        *out++ = regs.CC.Value;
+
+        batch.resize(out - batch.data());
+    }
+} // namespace
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (; size >= 8; size -= 8, bytes += 8) {
+        const uint32_t low = crc ^ (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) |
+                                    (static_cast<uint32_t>(bytes[3]) << 24));
+        crc = Tables[7][low & 0xFF] ^ Tables[6][(low >> 8) & 0xFF] ^
+              Tables[5][(low >> 16) & 0xFF] ^ Tables[4][low >> 24] ^ Tables[3][bytes[4]] ^
+              Tables[2][bytes[5]] ^ Tables[1][bytes[6]] ^ Tables[0][bytes[7]];
+    }
+    for (; size > 0; --size, ++bytes)
+        crc = (crc >> 8) ^ Tables[0][(crc ^ *bytes) & 0xFF];
+    return ~crc;
+}
+
+void InstructionHasher::Init(Mode mode, size_t granularity) {
+    m_mode = mode;
+    m_granularity = granularity;
+    m_hash = 0;
+    m_batch.clear();
+    BeginFrame();
+}
+
+void InstructionHasher::Add(const InstructionTraceInfo& traceInfo) {
+    if (m_mode == Mode::Legacy) {
+        m_hash = HashInstructionTraceInfo(m_hash, traceInfo);
+    } else {
+        AppendToBatch(m_batch, traceInfo);
+    }
+
+    ++m_instructionsInFrame;
+    if (++m_instructionsSinceCheckpoint == m_granularity)
+        AddCheckpoint();
+}
+
+void InstructionHasher::EndFrame() {
+    if (m_instructionsSinceCheckpoint > 0 || m_checkpoints.empty())
+        AddCheckpoint();
+}
+
+void InstructionHasher::BeginFrame() {
+    m_checkpoints.clear();
+    m_instructionsInFrame = 0;
+    m_instructionsSinceCheckpoint = 0;
+}
+
+void InstructionHasher::AddCheckpoint() {
+    if (!m_batch.empty()) {
+        m_hash = Crc32c(m_hash, m_batch.data(), m_batch.size());
+        m_batch.clear();
+    }
+    m_checkpoints.push_back(m_hash);
+    m_instructionsSinceCheckpoint = 0;
+}
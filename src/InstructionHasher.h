@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Base.h"
+#include <vector>
+
+struct InstructionTraceInfo;
+
+// Running hash of executed instructions, compared between server and client in sync mode to detect
+// when they diverge. Within each frame, a checkpoint of the hash is kept every granularity
+// instructions, so that a mismatch can be narrowed down to a range of instructions.
+class InstructionHasher {
+public:
+    enum class Mode {
+        // CRC32C of each field of each instruction, summed into the hash as done originally. Only
+        // useful to compare against older builds.
+        Legacy,
+        // Instructions are packed into a batch of bytes, and the CRC32C of the whole batch is
+        // computed once per checkpoint
+        Fast,
+    };
+
+    static const size_t FrameGranularity = 0; // One checkpoint per frame
+
+    void Init(Mode mode, size_t granularity);
+
+    Mode GetMode() const { return m_mode; }
+    size_t Granularity() const { return m_granularity; }
+
+    void Add(const InstructionTraceInfo& traceInfo);
+
+    // Hashes the instructions added since the last checkpoint, and adds the frame's last checkpoint
+    void EndFrame();
+
+    // Clears the checkpoints of the previous frame
+    void BeginFrame();
+
+    uint32_t Hash() const { return m_hash; }
+
+    // Hash after each group of granularity instructions in the frame, ending with the frame's
+    // hash. With a granularity of 1, checkpoint i is the hash after instruction i.
+    const std::vector<uint32_t>& Checkpoints() const { return m_checkpoints; }
+
+    size_t InstructionsInFrame() const { return m_instructionsInFrame; }
+
+private:
+    void AddCheckpoint();
+
+    Mode m_mode = Mode::Fast;
+    size_t m_granularity = FrameGranularity;
+    uint32_t m_hash{};
+    std::vector<uint8_t> m_batch;
+    std::vector<uint32_t> m_checkpoints;
+    size_t m_instructionsInFrame{};
+    size_t m_instructionsSinceCheckpoint{};
+};
+
+// CRC32C of data, continuing from crc. Chaining calls over consecutive blocks gives the same result
+// as a single call over all of them.
+uint32_t Crc32c(uint32_t crc, const void* data, size_t size);
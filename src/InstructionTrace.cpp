@@ -0,0 +1,495 @@
+#include "InstructionTrace.h"
+#include "ConsoleOutput.h"
+#include "CpuHelpers.h"
+#include "Platform.h"
+#include "RegexHelpers.h"
+#include "StringHelpers.h"
+#include <fstream>
+#include <vector>
+
+namespace {
+    const char* GetRegisterName(const CpuRegisters& cpuRegisters, const uint8_t& r) {
+        ptrdiff_t offset =
+            reinterpret_cast<const uint8_t*>(&r) - reinterpret_cast<const uint8_t*>(&cpuRegisters);
+        switch (offset) {
+        case offsetof(CpuRegisters, A):
+            return "A";
+        case offsetof(CpuRegisters, B):
+            return "B";
+        case offsetof(CpuRegisters, DP):
+            return "DP";
+        case offsetof(CpuRegisters, CC):
+            return "CC";
+        default:
+            FAIL();
+            return "INVALID";
+        }
+    };
+
+    const char* GetRegisterName(const CpuRegisters& cpuRegisters, const uint16_t& r) {
+        ptrdiff_t offset =
+            reinterpret_cast<const uint8_t*>(&r) - reinterpret_cast<const uint8_t*>(&cpuRegisters);
+        switch (offset) {
+        case offsetof(CpuRegisters, X):
+            return "X";
+        case offsetof(CpuRegisters, Y):
+            return "Y";
+        case offsetof(CpuRegisters, U):
+            return "U";
+        case offsetof(CpuRegisters, S):
+            return "S";
+        case offsetof(CpuRegisters, PC):
+            return "PC";
+        case offsetof(CpuRegisters, D):
+            return "D";
+        default:
+            FAIL();
+            return "INVALID";
+        }
+    };
+
+    void DisassembleOp_EXG_TFR(const Instruction& instruction, const CpuRegisters& cpuRegisters,
+                               std::string& disasmInstruction, std::string& comment) {
+        (void)cpuRegisters;
+        (void)comment;
+
+        const auto& cpuOp = instruction.cpuOp;
+        ASSERT(cpuOp->addrMode == AddressingMode::Inherent);
+        uint8_t postbyte = instruction.GetOperand(0);
+        uint8_t src = (postbyte >> 4) & 0b111;
+        uint8_t dst = postbyte & 0b111;
+        if (postbyte & BITS(3)) {
+            const char* const regName[]{"A", "B", "CC", "DP"};
+            disasmInstruction =
+                FormattedString<>("%s %s,%s", cpuOp->name, regName[src], regName[dst]);
+        } else {
+            const char* const regName[]{"D", "X", "Y", "U", "S", "PC"};
+            disasmInstruction =
+                FormattedString<>("%s %s,%s", cpuOp->name, regName[src], regName[dst]);
+        }
+    }
+
+    void DisassembleOp_PSH_PUL(const Instruction& instruction, const CpuRegisters& cpuRegisters,
+                               std::string& disasmInstruction, std::string& comment) {
+        (void)cpuRegisters;
+
+        const auto& cpuOp = instruction.cpuOp;
+        ASSERT(cpuOp->addrMode == AddressingMode::Immediate);
+        auto value = instruction.GetOperand(0);
+        std::vector<std::string> registers;
+        if (value & BITS(0))
+            registers.push_back("CC");
+        if (value & BITS(1))
+            registers.push_back("A");
+        if (value & BITS(2))
+            registers.push_back("B");
+        if (value & BITS(3))
+            registers.push_back("DP");
+        if (value & BITS(4))
+            registers.push_back("X");
+        if (value & BITS(5))
+            registers.push_back("Y");
+        if (value & BITS(6)) {
+            registers.push_back(cpuOp->opCode < 0x36 ? "U" : "S");
+        }
+        if (value & BITS(7))
+            registers.push_back("PC");
+
+        disasmInstruction = FormattedString<>("%s %s", cpuOp->name, Join(registers, ",").c_str());
+        comment = FormattedString<>("#$%02x (%d)", value, value);
+    }
+
+    void DisassembleIndexedInstruction(const Instruction& instruction,
+                                       const CpuRegisters& cpuRegisters,
+                                       std::string& disasmInstruction, std::string& comment) {
+        auto RegisterSelect = [&cpuRegisters](uint8_t postbyte) -> const uint16_t& {
+            switch ((postbyte >> 5) & 0b11) {
+            case 0b00:
+                return cpuRegisters.X;
+            case 0b01:
+                return cpuRegisters.Y;
+            case 0b10:
+                return cpuRegisters.U;
+            default: // 0b11:
+                return cpuRegisters.S;
+            }
+        };
+
+        uint16_t EA = 0;
+        uint8_t postbyte = instruction.GetOperand(0);
+        bool supportsIndirect = true;
+        std::string operands;
+
+        if ((postbyte & BITS(7)) == 0) // (+/- 4 bit offset),R
+        {
+            // postbyte is a 5 bit two's complement number we convert to 8 bit.
+            // So if bit 4 is set (sign bit), we extend the sign bit by turning on bits 6,7,8;
+            int8_t offset = postbyte & 0b0001'1111;
+            if (postbyte & BITS(4))
+                offset |= 0b1110'0000;
+            auto& reg = RegisterSelect(postbyte);
+            EA = reg + offset;
+            supportsIndirect = false;
+
+            operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
+            comment = FormattedString<>("%d,$%04x", offset, reg);
+        } else {
+            switch (postbyte & 0b1111) {
+            case 0b0000: { // ,R+
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg;
+                supportsIndirect = false;
+
+                operands = FormattedString<>(",%s+", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>(",$%04x+", reg);
+            } break;
+            case 0b0001: { // ,R++
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg;
+
+                operands = FormattedString<>(",%s++", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>(",$%04x++", reg);
+            } break;
+            case 0b0010: { // ,-R
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg - 1;
+                supportsIndirect = false;
+
+                operands = FormattedString<>(",-%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>(",-$%04x", reg);
+            } break;
+            case 0b0011: { // ,--R
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg - 2;
+
+                operands = FormattedString<>(",--%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>(",--$%04x", reg);
+            } break;
+            case 0b0100: { // ,R
+                auto& reg = RegisterSelect(postbyte);
+                EA = reg;
+
+                operands = FormattedString<>(",%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>(",$%04x", reg);
+            } break;
+            case 0b0101: { // (+/- B),R
+                auto& reg = RegisterSelect(postbyte);
+                auto offset = S16(cpuRegisters.B);
+                EA = reg + offset;
+
+                operands = FormattedString<>("B,%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>("%d,$%04x", offset, reg);
+            } break;
+            case 0b0110: { // (+/- A),R
+                auto& reg = RegisterSelect(postbyte);
+                auto offset = S16(cpuRegisters.A);
+                EA = reg + offset;
+
+                operands = FormattedString<>("A,%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>("%d,$%04x", offset, reg);
+            } break;
+            case 0b0111:
+                FAIL_MSG("Illegal");
+                break;
+            case 0b1000: { // (+/- 7 bit offset),R
+                auto& reg = RegisterSelect(postbyte);
+                uint8_t postbyte2 = instruction.GetOperand(1);
+                auto offset = S16(postbyte2);
+                EA = reg + offset;
+
+                operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>("%d,$%04x", offset, reg);
+            } break;
+            case 0b1001: { // (+/- 15 bit offset),R
+                uint8_t postbyte2 = instruction.GetOperand(1);
+                uint8_t postbyte3 = instruction.GetOperand(2);
+                auto& reg = RegisterSelect(postbyte);
+                auto offset = CombineToS16(postbyte2, postbyte3);
+                EA = reg + offset;
+
+                operands = FormattedString<>("%d,%s", offset, GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>("%d,$%04x", offset, reg);
+            } break;
+            case 0b1010:
+                FAIL_MSG("Illegal");
+                break;
+            case 0b1011: { // (+/- D),R
+                auto& reg = RegisterSelect(postbyte);
+                auto offset = S16(cpuRegisters.D);
+                EA = reg + offset;
+
+                operands = FormattedString<>("D,%s", GetRegisterName(cpuRegisters, reg));
+                comment = FormattedString<>("%d,$%04x", offset, reg);
+            } break;
+            case 0b1100: { // (+/- 7 bit offset),PC
+                uint8_t postbyte2 = instruction.GetOperand(1);
+                auto offset = S16(postbyte2);
+                EA = cpuRegisters.PC + offset;
+
+                operands = FormattedString<>("%d,PC", offset);
+                comment = FormattedString<>("%d,$%04x", offset, cpuRegisters.PC);
+            } break;
+            case 0b1101: { // (+/- 15 bit offset),PC
+                uint8_t postbyte2 = instruction.GetOperand(1);
+                uint8_t postbyte3 = instruction.GetOperand(2);
+                auto offset = CombineToS16(postbyte2, postbyte3);
+                EA = cpuRegisters.PC + offset;
+
+                operands = FormattedString<>("%d,PC", offset);
+                comment = FormattedString<>("%d,$%04x", offset, cpuRegisters.PC);
+            } break;
+            case 0b1110:
+                FAIL_MSG("Illegal");
+                break;
+            case 0b1111: { // [address] (Indirect-only)
+                uint8_t postbyte2 = instruction.GetOperand(1);
+                uint8_t postbyte3 = instruction.GetOperand(2);
+                EA = CombineToS16(postbyte2, postbyte3);
+            } break;
+            default:
+                FAIL_MSG("Illegal");
+                break;
+            }
+        }
+
+        if (supportsIndirect && (postbyte & BITS(4))) {
+            operands = FormattedString<>("[$%04x]", EA);
+        }
+
+        disasmInstruction = std::string(instruction.cpuOp->name) + " " + operands;
+    }
+
+    void PrintRegistersCompact(const CpuRegisters& cpuRegisters) {
+        const auto& r = cpuRegisters;
+        Printf("A$%02x|B$%02x|X$%04x|Y$%04x|U$%04x|S$%04x|DP$%02x|%s", r.A, r.B, r.X, r.Y, r.U, r.S,
+               r.DP, GetCCString(cpuRegisters).c_str());
+    }
+} // namespace
+
+Instruction DecodeInstruction(const std::array<uint8_t, 5>& opBytes) {
+    Instruction instruction{};
+    instruction.opBytes = opBytes;
+
+    int cpuOpPage = 0;
+    size_t opCodeIndex = 0;
+    if (IsOpCodePage1(instruction.opBytes[opCodeIndex])) {
+        cpuOpPage = 1;
+        ++opCodeIndex;
+    } else if (IsOpCodePage2(instruction.opBytes[opCodeIndex])) {
+        cpuOpPage = 2;
+        ++opCodeIndex;
+    }
+
+    instruction.cpuOp = &LookupCpuOp(cpuOpPage, instruction.opBytes[opCodeIndex]);
+    instruction.page = cpuOpPage;
+    instruction.firstOperandIndex = opCodeIndex + 1;
+    return instruction;
+}
+
+size_t InstructionSize(const Instruction& instruction) {
+    size_t size = instruction.cpuOp->size;
+    if (instruction.cpuOp->addrMode == AddressingMode::Indexed) {
+        const uint8_t postbyte = instruction.GetOperand(0);
+        if (postbyte & BITS(7)) {
+            switch (postbyte & 0b1111) {
+            case 0b1000: // (+/- 7 bit offset),R
+            case 0b1100: // (+/- 7 bit offset),PC
+                size += 1;
+                break;
+            case 0b1001: // (+/- 15 bit offset),R
+            case 0b1101: // (+/- 15 bit offset),PC
+            case 0b1111: // [address]
+                size += 2;
+                break;
+            }
+        }
+    }
+    return std::min(size, instruction.opBytes.size());
+}
+
+DisassembledOp DisassembleOp(const InstructionTraceInfo& traceInfo,
+                             const Debugger::SymbolTable& symbolTable) {
+    const auto& instruction = traceInfo.instruction;
+    const auto& cpuRegisters = traceInfo.preOpCpuRegisters;
+    const auto& cpuOp = instruction.cpuOp;
+
+    // Output instruction in hex
+    std::string hexInstruction;
+    for (uint16_t i = 0; i < cpuOp->size; ++i) {
+        hexInstruction += FormattedString<>("%02x", instruction.opBytes[i]);
+    }
+
+    std::string disasmInstruction, comment;
+
+    // First see if we have instruction-specific handlers. These are for special cases where the
+    // default addressing mode handlers don't give enough information.
+    bool handled = true;
+    switch (cpuOp->opCode) {
+    case 0x1E: // EXG
+    case 0x1F: // TFR
+        DisassembleOp_EXG_TFR(instruction, cpuRegisters, disasmInstruction, comment);
+        break;
+
+    case 0x34: // PSHS
+    case 0x35: // PULS
+    case 0x36: // PSHU
+    case 0x37: // PULU
+        DisassembleOp_PSH_PUL(instruction, cpuRegisters, disasmInstruction, comment);
+        break;
+
+    default:
+        handled = false;
+    }
+
+    // If no instruction-specific handler, we disassemble based on addressing mode.
+    if (!handled) {
+        switch (cpuOp->addrMode) {
+        case AddressingMode::Inherent: {
+            disasmInstruction = cpuOp->name;
+        } break;
+
+        case AddressingMode::Immediate: {
+            if (cpuOp->size == 2) {
+                auto value = instruction.GetOperand(0);
+                disasmInstruction = FormattedString<>("%s #$%02x", cpuOp->name, value);
+                comment = FormattedString<>("(%d)", value);
+            } else {
+                auto value = CombineToU16(instruction.GetOperand(0), instruction.GetOperand(1));
+                disasmInstruction = FormattedString<>("%s #$%04x", cpuOp->name, value);
+                comment = FormattedString<>("(%d)", value);
+            }
+        } break;
+
+        case AddressingMode::Extended: {
+            auto msb = instruction.GetOperand(0);
+            auto lsb = instruction.GetOperand(1);
+            uint16_t EA = CombineToU16(msb, lsb);
+            disasmInstruction = FormattedString<>("%s $%04x", cpuOp->name, EA);
+        } break;
+
+        case AddressingMode::Direct: {
+            uint16_t EA = CombineToU16(cpuRegisters.DP, instruction.GetOperand(0));
+            disasmInstruction =
+                FormattedString<>("%s $%02x", cpuOp->name, instruction.GetOperand(0));
+            comment = FormattedString<>("DP:(PC) = $%02x", EA);
+        } break;
+
+        case AddressingMode::Indexed: {
+            DisassembleIndexedInstruction(instruction, cpuRegisters, disasmInstruction,
+                                          comment);
+        } break;
+
+        case AddressingMode::Relative: {
+            // Branch instruction with 8 or 16 bit signed relative offset
+            uint16_t nextPC = cpuRegisters.PC + cpuOp->size;
+            if (cpuOp->size == 2) {
+                auto offset = static_cast<int8_t>(instruction.GetOperand(0));
+                disasmInstruction =
+                    FormattedString<>("%s $%02x", cpuOp->name, U16(offset) & 0x00FF);
+                comment =
+                    FormattedString<>("(%d), PC + offset = $%04x", offset, nextPC + offset);
+            } else {
+                // Could be a long branch from page 0 (3 bytes) or page 1 (4 bytes)
+                ASSERT(cpuOp->size >= 3);
+                auto offset = static_cast<int16_t>(
+                    CombineToU16(instruction.GetOperand(0), instruction.GetOperand(1)));
+                disasmInstruction = FormattedString<>("%s $%04x", cpuOp->name, offset);
+                comment =
+                    FormattedString<>("(%d), PC + offset = $%04x", offset, nextPC + offset);
+            }
+        } break;
+
+        case AddressingMode::Illegal: {
+        case AddressingMode::Variant:
+            FAIL_MSG("Unexpected addressing mode");
+        } break;
+        }
+    }
+
+    // Appends symbol names to known addresses
+    auto AppendSymbols = [&symbolTable](const std::string& s) {
+        if (!symbolTable.empty()) {
+            auto AppendSymbol = [&symbolTable](const std::smatch& m) -> std::string {
+                std::string result = m.str(0);
+                uint16_t address = StringToIntegral<uint16_t>(m.str(0));
+
+                auto range = symbolTable.equal_range(address);
+                if (range.first != range.second) {
+                    std::vector<std::string> symbols;
+                    std::transform(range.first, range.second, std::back_inserter(symbols),
+                                   [](auto& kvp) { return kvp.second; });
+
+                    result += "{" + Join(symbols, "|") + "}";
+                }
+                return result;
+            };
+
+            static const std::regex re("\\$[A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9][A-Fa-f0-9]");
+            return RegexReplace(s, re, AppendSymbol);
+        }
+        return s;
+    };
+
+    // Append memory accesses to comment section (if any)
+    {
+        // Skip the opcode + operand bytes - @TODO: we probably shouldn't be storing these in
+        // the first place
+        const size_t skipBytes = traceInfo.instruction.cpuOp->size;
+        const bool initialSpace = !comment.empty();
+        for (size_t i = skipBytes; i < traceInfo.numMemoryAccesses; ++i) {
+            auto& ma = traceInfo.memoryAccesses[i];
+            const char* separator = i == skipBytes ? (initialSpace ? " " : "") : " ";
+            comment += FormattedString<>("%s$%04x%s$%x", separator, ma.address,
+                                         ma.read ? "->" : "<-", ma.value);
+        }
+    }
+
+    disasmInstruction = AppendSymbols(disasmInstruction);
+    comment = AppendSymbols(comment);
+
+    return {hexInstruction, disasmInstruction, comment, cpuOp->description};
+}
+
+std::string GetCCString(const CpuRegisters& cpuRegisters) {
+    const auto& cc = cpuRegisters.CC;
+    return FormattedString<>("%c%c%c%c%c%c%c%c", cc.Entire ? 'E' : 'e',
+                             cc.FastInterruptMask ? 'F' : 'f', cc.HalfCarry ? 'H' : 'h',
+                             cc.InterruptMask ? 'I' : 'i', cc.Negative ? 'N' : 'n',
+                             cc.Zero ? 'Z' : 'z', cc.Overflow ? 'V' : 'v', cc.Carry ? 'C' : 'c')
+        .Value();
+}
+
+void PrintOp(const InstructionTraceInfo& traceInfo, const Debugger::SymbolTable& symbolTable) {
+    auto op = DisassembleOp(traceInfo, symbolTable);
+
+    using namespace Platform;
+    ScopedConsoleColor scc(ConsoleColor::Gray);
+    Printf("[$%04x] ", traceInfo.preOpCpuRegisters.PC);
+    SetConsoleColor(ConsoleColor::LightYellow);
+    Printf("%-10s ", op.hexInstruction.c_str());
+    SetConsoleColor(ConsoleColor::LightAqua);
+    Printf("%-32s ", op.disasmInstruction.c_str());
+    SetConsoleColor(ConsoleColor::LightGreen);
+    Printf("%-40s ", op.comment.c_str());
+    SetConsoleColor(ConsoleColor::LightPurple);
+    Printf("%2llu ", traceInfo.elapsedCycles);
+    PrintRegistersCompact(traceInfo.postOpCpuRegisters);
+    Printf("\n");
+}
+
+bool LoadUserSymbolsFile(const char* file, Debugger::SymbolTable& symbolTable) {
+    std::ifstream fin(file);
+    if (!fin)
+        return false;
+
+    std::string line;
+    while (std::getline(fin, line)) {
+        auto tokens = Split(line, " \t");
+        if (tokens.size() >= 3 && ((tokens[1].find("EQU") != -1) ||
+                                   (tokens[1].find("equ") != -1) || (tokens[1] == ":"))) {
+            auto address = StringToIntegral<uint16_t>(tokens[2]);
+            symbolTable.insert({address, tokens[0]});
+        }
+    }
+    return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Base.h"
+#include "Cpu.h"
+#include "CpuOpCodes.h"
+#include "Debugger.h"
+#include <array>
+#include <string>
+
+// Executed instructions as captured by the debugger's trace, and their disassembly, shared by the
+// debugger and the offline trace tool
+
+struct Instruction {
+    const CpuOp* cpuOp;
+    int page;
+    std::array<uint8_t, 5> opBytes; // Max 2 byte opcode + 3 byte operands
+    size_t firstOperandIndex = 0;
+
+    uint8_t GetOperand(size_t index) const { return opBytes[firstOperandIndex + index]; }
+};
+
+struct InstructionTraceInfo {
+    Instruction instruction{};
+    CpuRegisters preOpCpuRegisters;
+    CpuRegisters postOpCpuRegisters{};
+    cycles_t elapsedCycles{};
+
+    static const size_t MaxMemoryAccesses = 16;
+    struct MemoryAccess {
+        uint16_t address{};
+        uint16_t value{};
+        bool read{};
+    };
+    std::array<MemoryAccess, MaxMemoryAccesses> memoryAccesses;
+    size_t numMemoryAccesses = 0;
+
+    void AddMemoryAccess(uint16_t address, uint16_t value, bool read) {
+        assert(numMemoryAccesses < memoryAccesses.size());
+        memoryAccesses[numMemoryAccesses++] = {address, value, read};
+    }
+};
+
+// Builds the instruction from its bytes, starting with the op code (and page byte if any)
+Instruction DecodeInstruction(const std::array<uint8_t, 5>& opBytes);
+
+// Bytes taken by the instruction, including the extra operand bytes of some indexed modes
+size_t InstructionSize(const Instruction& instruction);
+
+struct DisassembledOp {
+    std::string hexInstruction;
+    std::string disasmInstruction;
+    std::string comment;
+    std::string description;
+};
+
+DisassembledOp DisassembleOp(const InstructionTraceInfo& traceInfo,
+                             const Debugger::SymbolTable& symbolTable);
+
+std::string GetCCString(const CpuRegisters& cpuRegisters);
+
+// Prints the disassembled op with its cycles and the registers after it, on a single line
+void PrintOp(const InstructionTraceInfo& traceInfo, const Debugger::SymbolTable& symbolTable);
+
+// Loads "name EQU address" and "name : address" definitions
+bool LoadUserSymbolsFile(const char* file, Debugger::SymbolTable& symbolTable);
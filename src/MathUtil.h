@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Serializer.h"
+
 namespace MathUtil {
     class AverageValue {
     public:
@@ -11,17 +13,30 @@ namespace MathUtil {
             m_sum += v;
             ++m_count;
         }
-        float Sum() const { return m_sum; }
+        // Same as adding v count times, but in one go. The sum is kept in double, which holds sums
+        // of the few dozen floats averaged into an audio sample exactly, so that both give the same
+        // result.
+        void Add(float v, size_t count) {
+            m_sum += static_cast<double>(v) * count;
+            m_count += count;
+        }
+        double Sum() const { return m_sum; }
         size_t Count() const { return m_count; }
-        float Average() const { return m_count == 0 ? 0 : m_sum / m_count; }
+        float Average() const { return m_count == 0 ? 0 : static_cast<float>(m_sum / m_count); }
         float AverageAndReset() {
             auto result = Average();
             Reset();
             return result;
         }
 
+        void Serialize(Serializer& s) {
+            uint64_t count = m_count;
+            s.Serialize(m_sum, count);
+            m_count = static_cast<size_t>(count);
+        }
+
     private:
-        float m_sum{};
+        double m_sum{};
         size_t m_count{};
     };
 } // namespace MathUtil
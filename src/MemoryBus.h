@@ -1,9 +1,8 @@
 #pragma once
 
 #include "Base.h"
-#include <algorithm>
+#include <array>
 #include <functional>
-#include <vector>
 
 using MemoryRange = std::pair<uint16_t, uint16_t>;
 
@@ -14,67 +13,112 @@ struct IMemoryBusDevice {
 
 class MemoryBus {
 public:
+    // Devices are looked up by page, so connected ranges must be page aligned
+    static constexpr size_t PageSize = 256;
+    static constexpr size_t NumPages = 0x10000 / PageSize;
+
     void ConnectDevice(IMemoryBusDevice& device, MemoryRange range) {
-        m_devices.push_back(DeviceInfo{&device, range});
+        ASSERT_MSG(range.first % PageSize == 0 && (range.second + 1) % PageSize == 0,
+                   "Device range [$%04x, $%04x] is not page aligned", range.first, range.second);
+
+        for (size_t page = range.first / PageSize; page <= range.second / PageSize; ++page) {
+            ASSERT_MSG(m_pages[page].device == nullptr, "Device range overlaps another at $%04x",
+                       static_cast<unsigned int>(page * PageSize));
+            m_pages[page] = Page{&device};
+        }
+    }
 
-        std::sort(m_devices.begin(), m_devices.end(),
-                  [](const DeviceInfo& info1, const DeviceInfo& info2) {
-                      return info1.memoryRange.first < info2.memoryRange.first;
-                  });
+    // Fast path for plain memory devices (RAM, ROM): pages of range that are fully backed by data
+    // are read, and written if writable, directly instead of through the connected device. Pages
+    // past the end of data still go through the device. Must be called again if data moves.
+    void MapMemory(MemoryRange range, uint8_t* data, size_t size, bool writable) {
+        for (size_t page = range.first / PageSize; page <= range.second / PageSize; ++page) {
+            auto& pageInfo = m_pages[page];
+            ASSERT_MSG(pageInfo.device != nullptr, "Mapping memory to page with no device");
+
+            const size_t offset = page * PageSize - range.first;
+            const bool backed = offset + PageSize <= size;
+            pageInfo.memory = backed ? data + offset : nullptr;
+            pageInfo.writable = backed && writable;
+        }
     }
 
     //@TODO: Move this callback stuff out of here, perhaps in some DebuggerMemoryBus class.
+    // Callbacks are only meant to be registered while needed (e.g. by the debugger for tracing or
+    // watchpoints). When none are registered, or they are disabled, Read/Write only pay for a
+    // single flag test.
     using OnReadCallback = std::function<void(uint16_t, uint8_t)>;
     using OnWriteCallback = std::function<void(uint16_t, uint8_t)>;
     void RegisterCallbacks(OnReadCallback onReadCallback, OnWriteCallback onWriteCallback) {
         m_onReadCallback = onReadCallback;
         m_onWriteCallback = onWriteCallback;
+        UpdateCallbacksActive();
+    }
+
+    void UnregisterCallbacks() { RegisterCallbacks({}, {}); }
+
+    void SetCallbacksEnabled(bool enabled) {
+        m_callbacksEnabled = enabled;
+        UpdateCallbacksActive();
     }
 
-    void SetCallbacksEnabled(bool enabled) { m_callbacksEnabled = enabled; }
+    bool ReadCallbackActive() const { return m_readCallbackActive; }
+
+    // Called before any access that goes to a device rather than directly mapped memory, so that
+    // devices that are updated lazily can catch up first (see Cpu::ExecuteBlock).
+    using OnDeviceAccessCallback = std::function<void()>;
+    void SetDeviceAccessCallback(OnDeviceAccessCallback onDeviceAccessCallback) {
+        m_onDeviceAccessCallback = std::move(onDeviceAccessCallback);
+    }
 
     uint8_t Read(uint16_t address) const {
-        uint8_t value = FindDeviceInfo(address).device->Read(address);
+        const Page& page = m_pages[address / PageSize];
+        uint8_t value =
+            page.memory ? page.memory[address % PageSize] : AccessDevice(page).Read(address);
 
-        if (m_callbacksEnabled && m_onReadCallback)
+        if (m_readCallbackActive)
             m_onReadCallback(address, value);
 
         return value;
     }
 
     void Write(uint16_t address, uint8_t value) {
-        if (m_callbacksEnabled && m_onWriteCallback)
+        if (m_writeCallbackActive)
             m_onWriteCallback(address, value);
 
-        FindDeviceInfo(address).device->Write(address, value);
+        Page& page = m_pages[address / PageSize];
+        if (page.writable)
+            page.memory[address % PageSize] = value;
+        else
+            AccessDevice(page).Write(address, value);
     }
 
 private:
-    struct DeviceInfo {
+    struct Page {
         IMemoryBusDevice* device = nullptr;
-        MemoryRange memoryRange;
+        uint8_t* memory = nullptr; // If set, points to this page's memory for direct access
+        bool writable = false;
     };
 
-    const DeviceInfo& FindDeviceInfo(uint16_t address) const {
-        // We assume at least 1 device is connected. This one condition allows us to check the
-        // address against the end of each range in the inner loop.
-        if (address >= m_devices[0].memoryRange.first) {
-            for (const auto& info : m_devices) {
-                if (address <= info.memoryRange.second) {
-                    return info;
-                }
-            }
-        }
+    IMemoryBusDevice& AccessDevice(const Page& page) const {
+        if (!page.device)
+            FAIL_MSG("Unmapped address");
+        if (m_onDeviceAccessCallback)
+            m_onDeviceAccessCallback();
+        return *page.device;
+    }
 
-        FAIL_MSG("Unmapped address");
-        static DeviceInfo nullDeviceInfo{};
-        return nullDeviceInfo;
+    void UpdateCallbacksActive() {
+        m_readCallbackActive = m_callbacksEnabled && m_onReadCallback;
+        m_writeCallbackActive = m_callbacksEnabled && m_onWriteCallback;
     }
 
-    // Sorted by first address in range
-    std::vector<DeviceInfo> m_devices;
+    std::array<Page, NumPages> m_pages;
 
     bool m_callbacksEnabled = true;
+    bool m_readCallbackActive = false;
+    bool m_writeCallbackActive = false;
     OnReadCallback m_onReadCallback;
     OnWriteCallback m_onWriteCallback;
+    OnDeviceAccessCallback m_onDeviceAccessCallback;
 };
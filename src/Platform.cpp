@@ -103,7 +103,9 @@ namespace Platform {
 
 #elif defined(PLATFORM_LINUX)
 
+#if !defined(VECTREXY_HEADLESS)
 #include "linenoise/linenoise.h"
+#endif
 #include <signal.h>
 #include <unistd.h>
 
@@ -155,6 +157,13 @@ namespace Platform {
     }
 
     std::string ConsoleReadLine(const char* prompt) {
+#if defined(VECTREXY_HEADLESS)
+        // No linenoise in headless builds, so fall back to plain line input
+        std::cout << prompt << std::flush;
+        std::string result;
+        std::getline(std::cin, result);
+        return result;
+#else
         while (true) {
             fflush(stdout);
             if (char* line = linenoise(prompt)) {
@@ -167,6 +176,7 @@ namespace Platform {
             // just keep looping until we get a valid string.
         }
         return {};
+#endif
     }
 
     bool ExecuteShellCommand(const char* command) {
@@ -186,6 +196,19 @@ namespace Platform {
 #endif
 
 // Implement Platform::OpenFileDialog using no_file_dialog
+#if defined(VECTREXY_HEADLESS)
+
+namespace Platform {
+    // Headless builds have no UI toolkit to show a dialog with
+    std::optional<std::string> OpenFileDialog(const char* /*title*/, const char* /*filterName*/,
+                                              const char* /*filterTypes*/,
+                                              std::optional<fs::path> /*initialPath*/) {
+        return {};
+    }
+} // namespace Platform
+
+#else
+
 #if defined(PLATFORM_WINDOWS)
 #define NOC_FILE_DIALOG_IMPLEMENTATION
 #define NOC_FILE_DIALOG_WIN32
@@ -224,3 +247,5 @@ namespace Platform {
         return {};
     }
 } // namespace Platform
+
+#endif // defined(VECTREXY_HEADLESS)
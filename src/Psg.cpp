@@ -1,10 +1,14 @@
 #include "Psg.h"
+#include "BandLimitedBuffer.h"
 #include "BitOps.h"
 #include "EngineClient.h"
 #include "ErrorHandler.h"
 #include "Gui.h"
+#include "MathUtil.h"
+#include "Serializer.h"
 #include <array>
 #include <cmath>
+#include <limits>
 #include <memory>
 
 namespace {
@@ -112,6 +116,30 @@ namespace {
             return false;
         }
 
+        // Number of Clock() calls up to and including the one that expires the timer
+        uint64_t TicksUntilExpiry() const {
+            if (m_period == 0)
+                return std::numeric_limits<uint64_t>::max();
+            // Time can be past the period, in which case it only expires once it wraps around
+            const uint32_t ticks = m_period - m_time;
+            return ticks == 0 ? (uint64_t{1} << 32) : ticks;
+        }
+
+        // Same as calling Clock() the given number of times, returning how many times it expired
+        uint64_t Advance(uint64_t ticks) {
+            const uint64_t ticksUntilExpiry = TicksUntilExpiry();
+            if (ticks < ticksUntilExpiry) {
+                if (m_period > 0)
+                    m_time += static_cast<uint32_t>(ticks);
+                return 0;
+            }
+            ticks -= ticksUntilExpiry;
+            m_time = static_cast<uint32_t>(ticks % m_period);
+            return 1 + ticks / m_period;
+        }
+
+        void Serialize(Serializer& s) { s.Serialize(m_period, m_time); }
+
     private:
         uint32_t m_period{};
         uint32_t m_time{}; // Time in period
@@ -143,8 +171,22 @@ namespace {
             }
         }
 
+        // Clocks until the value next changes
+        uint64_t TicksUntilChange() const { return m_timer.TicksUntilExpiry(); }
+
+        // Clocks for fewer ticks than TicksUntilChange()
+        void Skip(uint64_t ticks) {
+            [[maybe_unused]] auto expired = m_timer.Advance(ticks);
+            assert(expired == 0);
+        }
+
         uint32_t Value() const { return m_value; }
 
+        void Serialize(Serializer& s) {
+            m_timer.Serialize(s);
+            s.Serialize(m_period, m_value);
+        }
+
     private:
         void OnPeriodUpdated() {
             // Note: changing period does not reset value
@@ -176,8 +218,22 @@ namespace {
             }
         }
 
+        // Clocks until the shift register is next clocked, which may change the value
+        uint64_t TicksUntilChange() const { return m_timer.TicksUntilExpiry(); }
+
+        // Clocks for fewer ticks than TicksUntilChange()
+        void Skip(uint64_t ticks) {
+            [[maybe_unused]] auto expired = m_timer.Advance(ticks);
+            assert(expired == 0);
+        }
+
         uint32_t Value() const { return m_value; }
 
+        void Serialize(Serializer& s) {
+            m_timer.Serialize(s);
+            s.Serialize(m_period, m_shiftRegister, m_value);
+        }
+
     private:
         void ClockShiftRegister() {
             // From http://www.cpcwiki.eu/index.php/PSG#06h_-_Noise_Frequency_.285bit.29
@@ -230,8 +286,28 @@ namespace {
             }
         }
 
+        // Clocks until the value is next updated
+        uint64_t TicksUntilChange() const {
+            const uint64_t timerTicks = m_timer.TicksUntilExpiry();
+            if (timerTicks == std::numeric_limits<uint64_t>::max())
+                return timerTicks;
+            return m_divider.TicksUntilExpiry() + (timerTicks - 1) * m_divider.Period();
+        }
+
+        // Clocks for fewer ticks than TicksUntilChange()
+        void Skip(uint64_t ticks) {
+            [[maybe_unused]] auto expired = m_timer.Advance(m_divider.Advance(ticks));
+            assert(expired == 0);
+        }
+
         uint32_t Value() const { return m_value; }
 
+        void Serialize(Serializer& s) {
+            m_divider.Serialize(s);
+            m_timer.Serialize(s);
+            s.Serialize(m_period, m_value, m_shape, m_currShapeIndex);
+        }
+
     private:
         void OnPeriodUpdated() {
             //@TODO: why am I dividing by 16 here?
@@ -349,9 +425,17 @@ namespace {
             // CPCs stereo connector seem to be slightly different though). amplitude = max /
             // sqrt(2)^(15-nn) eg. 15 --> max / 1, 14 --> max / 1.414, 13 --> max / 2, etc.
             // http://www.cpcwiki.eu/index.php/PSG#0Ah_-_Channel_C_Volume_.280-0Fh.3Dvolume.2C_10h.3Duse_envelope_instead.29
-            return 1.f / ::powf(::sqrtf(2), 15.f - volume);
+            static const auto volumes = [] {
+                std::array<float, 16> result{};
+                for (uint32_t i = 0; i < result.size(); ++i)
+                    result[i] = 1.f / ::powf(::sqrtf(2), 15.f - i);
+                return result;
+            }();
+            return volumes[volume];
         }
 
+        void Serialize(Serializer& s) { s.Serialize(m_mode, m_fixedVolume); }
+
     private:
         AmplitudeMode m_mode = AmplitudeMode::Fixed;
         uint32_t m_fixedVolume{};
@@ -414,6 +498,12 @@ namespace {
             return finalSample;
         }
 
+        // Generators are shared between channels, so they're serialized by the owner
+        void Serialize(Serializer& s) {
+            s.Serialize(m_toneEnabled, m_noiseEnabled);
+            m_amplitudeControl.Serialize(s);
+        }
+
     private:
         bool m_toneEnabled{};
         bool m_noiseEnabled{};
@@ -439,13 +529,21 @@ public:
 
     void Reset();
     void Update(cycles_t cycles);
+    void Render(cycles_t cycles, MathUtil::AverageValue& samples);
+    void Render(cycles_t cycles, float time, float samplesPerCycle, BandLimitedBuffer& buffer);
 
     float Sample() const;
 
     void FrameUpdate(double frameTime);
 
+    void Serialize(Serializer& s);
+
 private:
     void Clock();
+    template <typename OnSpan>
+    void RenderSpans(cycles_t cycles, OnSpan onSpan);
+    cycles_t CyclesUntilGeneratorsChange() const;
+    void SkipCycles(cycles_t cycles);
 
     uint8_t Read(uint16_t address);
     void Write(uint16_t address, uint8_t value);
@@ -458,6 +556,13 @@ private:
         LatchAddress // BDIR on  BC1 on
     };
 
+    PsgMode ModeFromBDIRandBC1() const {
+        uint8_t value{};
+        SetBits(value, 0b10, m_BDIR);
+        SetBits(value, 0b01, m_BC1);
+        return static_cast<PsgMode>(value);
+    }
+
     PsgMode m_mode = PsgMode::Inactive;
 
     bool m_BDIR{};
@@ -470,6 +575,18 @@ private:
     NoiseGenerator m_noiseGenerator{};
     EnvelopeGenerator m_envelopeGenerator{};
     std::array<PsgChannel, 3> m_channels;
+
+    // Debug UI state, with the histories only allocated once shown
+    static const int NumHistoryValues = 5000;
+    struct DebugHistories {
+        std::array<PlotData<float, NumHistoryValues>, 3> channelHistories;
+        std::array<PlotData<float, NumHistoryValues>, 3> toneHistories;
+        std::array<PlotData<float, NumHistoryValues>, 3> noiseHistories;
+        std::array<PlotData<float, NumHistoryValues>, 3> volumeHistories;
+        PlotData<float, NumHistoryValues> envelopeHistory;
+    };
+    bool m_imGuiEnabled = false;
+    std::unique_ptr<DebugHistories> m_debugHistories;
 };
 
 PsgImpl::PsgImpl()
@@ -505,11 +622,79 @@ void PsgImpl::Update(cycles_t cycles) {
     }
 }
 
+template <typename OnSpan>
+void PsgImpl::RenderSpans(cycles_t cycles, OnSpan onSpan) {
+    // The output only changes on cycles where a register is accessed or a generator changes, so
+    // we clock those one at a time, and skip over the spans in between, passing on the unchanged
+    // output once for the whole span.
+    while (cycles > 0) {
+        // Registers are accessed on the first cycle after BDIR/BC1 change, which only happens
+        // between calls.
+        if (m_mode != ModeFromBDIRandBC1()) {
+            Clock();
+            onSpan(1);
+            --cycles;
+            continue;
+        }
+
+        const cycles_t span = std::min(cycles, CyclesUntilGeneratorsChange() - 1);
+        if (span > 0) {
+            SkipCycles(span);
+            onSpan(span);
+            cycles -= span;
+        }
+
+        if (cycles > 0) {
+            Clock();
+            onSpan(1);
+            --cycles;
+        }
+    }
+}
+
+void PsgImpl::Render(cycles_t cycles, MathUtil::AverageValue& samples) {
+    RenderSpans(cycles, [&](cycles_t span) { samples.Add(Sample(), span); });
+}
+
+void PsgImpl::Render(cycles_t cycles, float time, float samplesPerCycle,
+                     BandLimitedBuffer& buffer) {
+    RenderSpans(cycles, [&](cycles_t span) {
+        buffer.SetLevel(time, Sample());
+        time += span * samplesPerCycle;
+    });
+}
+
+// Returns the number of cycles up to and including the next one on which a generator's value
+// changes.
+cycles_t PsgImpl::CyclesUntilGeneratorsChange() const {
+    uint64_t ticks = std::min(m_noiseGenerator.TicksUntilChange(),
+                              m_envelopeGenerator.TicksUntilChange());
+    for (auto& toneGenerator : m_toneGenerators) {
+        ticks = std::min(ticks, toneGenerator.TicksUntilChange());
+    }
+
+    if (ticks == std::numeric_limits<uint64_t>::max())
+        return ticks;
+
+    // Generators are clocked every 16 cycles
+    return m_masterDivider.TicksUntilExpiry() + (ticks - 1) * m_masterDivider.Period();
+}
+
+// Same as calling Clock() for fewer cycles than CyclesUntilGeneratorsChange(), with BDIR/BC1
+// unchanged since the last one.
+void PsgImpl::SkipCycles(cycles_t cycles) {
+    const uint64_t ticks = m_masterDivider.Advance(cycles);
+    for (auto& toneGenerator : m_toneGenerators) {
+        toneGenerator.Skip(ticks);
+    }
+    m_noiseGenerator.Skip(ticks);
+    m_envelopeGenerator.Skip(ticks);
+}
+
 void PsgImpl::FrameUpdate(double frameTime) {
     // Debug output
-    static bool PsgImGui = false;
-    IMGUI_CALL(Debug, ImGui::Checkbox("<<< Psg >>>", &PsgImGui));
-    if (PsgImGui) {
+    IMGUI_CALL(Debug, ImGui::Checkbox("<<< Psg >>>", &m_imGuiEnabled));
+    if (m_imGuiEnabled) {
         auto IndexToChannelName = [](auto index) {
             switch (index) {
             case 0:
@@ -526,12 +711,13 @@ void PsgImpl::FrameUpdate(double frameTime) {
             return FormattedString<>("%s##%d", name, (int)index);
         };
 
-        const int NumHistoryValues = 5000;
-        static std::array<PlotData<float, NumHistoryValues>, 3> channelHistories;
-        static std::array<PlotData<float, NumHistoryValues>, 3> toneHistories;
-        static std::array<PlotData<float, NumHistoryValues>, 3> noiseHistories;
-        static std::array<PlotData<float, NumHistoryValues>, 3> volumeHistories;
-        static PlotData<float, NumHistoryValues> envelopeHistory;
+        if (!m_debugHistories)
+            m_debugHistories = std::make_unique<DebugHistories>();
+        auto& channelHistories = m_debugHistories->channelHistories;
+        auto& toneHistories = m_debugHistories->toneHistories;
+        auto& noiseHistories = m_debugHistories->noiseHistories;
+        auto& volumeHistories = m_debugHistories->volumeHistories;
+        auto& envelopeHistory = m_debugHistories->envelopeHistory;
 
         for (size_t i = 0; i < m_channels.size(); ++i) {
             auto& channel = m_channels[i];
@@ -589,15 +775,8 @@ void PsgImpl::FrameUpdate(double frameTime) {
 }
 
 void PsgImpl::Clock() {
-    auto ModeFromBDIRandBC1 = [](bool BDIR, bool BC1) -> PsgImpl::PsgMode {
-        uint8_t value{};
-        SetBits(value, 0b10, BDIR);
-        SetBits(value, 0b01, BC1);
-        return static_cast<PsgImpl::PsgMode>(value);
-    };
-
     const auto lastMode = m_mode;
-    m_mode = ModeFromBDIRandBC1(m_BDIR, m_BC1);
+    m_mode = ModeFromBDIRandBC1();
 
     switch (m_mode) {
     case PsgMode::Inactive:
@@ -629,6 +808,17 @@ void PsgImpl::Clock() {
     }
 }
 
+void PsgImpl::Serialize(Serializer& s) {
+    s.Serialize(m_mode, m_BDIR, m_BC1, m_DA, m_latchedAddress, m_registers);
+    m_masterDivider.Serialize(s);
+    for (auto& toneGenerator : m_toneGenerators)
+        toneGenerator.Serialize(s);
+    m_noiseGenerator.Serialize(s);
+    m_envelopeGenerator.Serialize(s);
+    for (auto& channel : m_channels)
+        channel.Serialize(s);
+}
+
 float PsgImpl::Sample() const {
     // Sample and mix each of the 3 channels
     float sample = 0.f;
@@ -773,6 +963,14 @@ void Psg::Update(cycles_t cycles) {
     m_impl->Update(cycles);
 }
 
+void Psg::Render(cycles_t cycles, MathUtil::AverageValue& samples) {
+    m_impl->Render(cycles, samples);
+}
+
+void Psg::Render(cycles_t cycles, float time, float samplesPerCycle, BandLimitedBuffer& buffer) {
+    m_impl->Render(cycles, time, samplesPerCycle, buffer);
+}
+
 float Psg::Sample() const {
     return m_impl->Sample();
 }
@@ -780,3 +978,7 @@ float Psg::Sample() const {
 void Psg::FrameUpdate(double frameTime) {
     return m_impl->FrameUpdate(frameTime);
 }
+
+void Psg::Serialize(Serializer& s) {
+    m_impl->Serialize(s);
+}
@@ -3,6 +3,12 @@
 #include "Base.h"
 #include "Pimpl.h"
 
+class BandLimitedBuffer;
+class Serializer;
+namespace MathUtil {
+    class AverageValue;
+}
+
 // Implementation of the AY-3-8912 Programmable Sound Generator (PSG)
 
 class Psg {
@@ -23,10 +29,20 @@ public:
     void Reset();
     void Update(cycles_t cycles);
 
+    // Same as calling Update(1) then adding Sample() to samples for each cycle, but only clocks
+    // the generators on cycles where one of them changes
+    void Render(cycles_t cycles, MathUtil::AverageValue& samples);
+
+    // Same, but adds every change of output to buffer as a band-limited step instead, the first
+    // cycle being at the given time in output samples
+    void Render(cycles_t cycles, float time, float samplesPerCycle, BandLimitedBuffer& buffer);
+
     float Sample() const;
 
     void FrameUpdate(double frameTime);
 
+    void Serialize(Serializer& s);
+
 private:
-    pimpl::Pimpl<class PsgImpl, 256> m_impl;
+    pimpl::Pimpl<class PsgImpl, 272> m_impl;
 };
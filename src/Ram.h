@@ -2,12 +2,23 @@
 
 #include "MemoryBus.h"
 #include "MemoryMap.h"
+#include "Serializer.h"
 #include <array>
 #include <random>
 
 class Ram : public IMemoryBusDevice {
 public:
-    void Init(MemoryBus& memoryBus) { memoryBus.ConnectDevice(*this, MemoryMap::Ram.range); }
+    void Init(MemoryBus& memoryBus) {
+        memoryBus.ConnectDevice(*this, MemoryMap::Ram.range);
+
+        // Map every shadowed copy of RAM to the same memory for direct access
+        const auto& range = MemoryMap::Ram.range;
+        for (size_t first = range.first; first <= range.second; first += m_data.size()) {
+            const MemoryRange mirror{checked_static_cast<uint16_t>(first),
+                                     checked_static_cast<uint16_t>(first + m_data.size() - 1)};
+            memoryBus.MapMemory(mirror, m_data.data(), m_data.size(), true);
+        }
+    }
 
     void Reset() { std::fill(m_data.begin(), m_data.end(), static_cast<uint8_t>(0)); }
 
@@ -19,6 +30,8 @@ public:
                        [&](auto&) { return static_cast<uint8_t>(distribution(engine)); });
     }
 
+    void Serialize(Serializer& s) { s.Serialize(m_data); }
+
 private:
     uint8_t Read(uint16_t address) const override {
         return m_data[MemoryMap::Ram.MapAddress(address)];
@@ -28,5 +41,5 @@ private:
         m_data[MemoryMap::Ram.MapAddress(address)] = value;
     }
 
-    std::array<uint8_t, 1024> m_data;
+    std::array<uint8_t, MemoryMap::Ram.logicalSize> m_data;
 };
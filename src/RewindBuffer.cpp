@@ -0,0 +1,194 @@
+#include "RewindBuffer.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    // Delta encoding: a sequence of runs, each made of a count of bytes that are the same as the
+    // keyframe's, a count of bytes that differ, then that many bytes XORed with the keyframe's.
+    using RunLength = uint16_t;
+    const size_t MaxRunLength = std::numeric_limits<RunLength>::max();
+
+    void AppendRunLength(std::vector<uint8_t>& delta, size_t length) {
+        const auto value = static_cast<RunLength>(length);
+        const auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        delta.insert(delta.end(), bytes, bytes + sizeof(value));
+    }
+
+    size_t ReadRunLength(const uint8_t* delta, size_t& pos) {
+        RunLength value{};
+        std::copy_n(&delta[pos], sizeof(value), reinterpret_cast<uint8_t*>(&value));
+        pos += sizeof(value);
+        return value;
+    }
+} // namespace
+
+void RewindBuffer::Init(size_t maxFrames, size_t stateSize, size_t deltaStorageSize) {
+    Clear();
+    m_frames.Init(maxFrames);
+
+    // Enough for the keyframes of maxFrames frames, plus the one after them
+    m_keyframes.resize((maxFrames + KeyframeInterval - 1) / KeyframeInterval + 2);
+    for (auto& keyframe : m_keyframes) {
+        keyframe = std::make_shared<State>();
+        keyframe->reserve(stateSize);
+    }
+    // Deltas are never larger than the state
+    m_encodedDelta.reserve(stateSize);
+    m_deltaStorage.resize(deltaStorageSize);
+}
+
+void RewindBuffer::Clear() {
+    // Release the frames' references to their keyframes, so that the pool can hand them out again
+    Frame frame;
+    while (m_frames.PopBack(frame)) {
+    }
+    m_keyframe.reset();
+    m_deltaBegin = m_deltaEnd = m_numDeltas = 0;
+    m_framesSinceKeyframe = 0;
+    m_memoryUsed = 0;
+}
+
+void RewindBuffer::Push(const std::vector<uint8_t>& state) {
+    if (m_frames.TotalSize() == 0)
+        return;
+
+    if (m_frames.Full())
+        DropOldestFrame();
+
+    Frame frame;
+    const bool startKeyframe = !m_keyframe || m_framesSinceKeyframe >= KeyframeInterval ||
+                               m_keyframe->size() != state.size();
+    if (!startKeyframe && EncodeDelta(state, *m_keyframe, m_encodedDelta) &&
+        AllocateDelta(m_encodedDelta.size(), frame.deltaOffset)) {
+        frame.keyframe = m_keyframe;
+        frame.deltaSize = m_encodedDelta.size();
+        std::copy(m_encodedDelta.begin(), m_encodedDelta.end(),
+                  m_deltaStorage.begin() + frame.deltaOffset);
+    } else {
+        // Also stored as a keyframe when the delta wouldn't be smaller, or there's no room for it
+        m_keyframe.reset();
+        m_keyframe = FreeKeyframe();
+        *m_keyframe = state; // Only allocates if states have grown past the size passed to Init
+        m_framesSinceKeyframe = 0;
+        frame.keyframe = m_keyframe;
+    }
+    ++m_framesSinceKeyframe;
+
+    m_memoryUsed += FrameMemory(frame);
+    m_frames.PushBack(std::move(frame));
+}
+
+bool RewindBuffer::Pop(std::vector<uint8_t>& state) {
+    Frame frame;
+    if (m_frames.PopBack(frame) == 0)
+        return false;
+
+    m_memoryUsed -= FrameMemory(frame);
+
+    if (frame.deltaSize == 0) {
+        state = *frame.keyframe;
+    } else {
+        DecodeDelta(&m_deltaStorage[frame.deltaOffset], frame.deltaSize, *frame.keyframe, state);
+        m_deltaEnd = frame.deltaOffset;
+        --m_numDeltas;
+    }
+
+    // Start a new keyframe on the next push, as the current one may have just been popped
+    m_keyframe.reset();
+    return true;
+}
+
+void RewindBuffer::DropOldestFrame() {
+    Frame frame;
+    m_frames.PopFront(frame);
+    m_memoryUsed -= FrameMemory(frame);
+    if (frame.deltaSize > 0) {
+        m_deltaBegin = frame.deltaOffset + frame.deltaSize;
+        --m_numDeltas;
+    }
+}
+
+std::shared_ptr<RewindBuffer::State> RewindBuffer::FreeKeyframe() {
+    for (;;) {
+        for (auto& keyframe : m_keyframes) {
+            if (keyframe.use_count() == 1)
+                return keyframe;
+        }
+        // Every keyframe is still referenced by a frame (which only happens once deltas have
+        // fallen back to keyframes), so free up the oldest ones
+        ASSERT(!m_frames.Empty());
+        DropOldestFrame();
+    }
+}
+
+bool RewindBuffer::AllocateDelta(size_t size, size_t& offset) {
+    if (m_numDeltas == 0)
+        m_deltaBegin = m_deltaEnd = 0;
+
+    if (m_deltaEnd >= m_deltaBegin) {
+        // Free space is after the last delta, and before the first one
+        if (m_deltaStorage.size() - m_deltaEnd >= size) {
+            offset = m_deltaEnd;
+        } else if (m_deltaBegin > size) {
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        // Wrapped around: free space is between the last delta and the first one. Never fill it
+        // completely, so that m_deltaEnd == m_deltaBegin only ever means there are no deltas.
+        if (m_deltaBegin - m_deltaEnd > size) {
+            offset = m_deltaEnd;
+        } else {
+            return false;
+        }
+    }
+
+    m_deltaEnd = offset + size;
+    ++m_numDeltas;
+    return true;
+}
+
+bool RewindBuffer::EncodeDelta(const State& state, const State& keyframe, State& delta) {
+    ASSERT(state.size() == keyframe.size());
+    delta.clear();
+
+    size_t i = 0;
+    while (i < state.size()) {
+        const size_t sameStart = i;
+        while (i < state.size() && i - sameStart < MaxRunLength && state[i] == keyframe[i])
+            ++i;
+
+        const size_t diffStart = i;
+        while (i < state.size() && i - diffStart < MaxRunLength && state[i] != keyframe[i])
+            ++i;
+
+        if (delta.size() + 2 * sizeof(RunLength) + (i - diffStart) > state.size())
+            return false;
+
+        AppendRunLength(delta, diffStart - sameStart);
+        AppendRunLength(delta, i - diffStart);
+        for (size_t j = diffStart; j < i; ++j)
+            delta.push_back(state[j] ^ keyframe[j]);
+    }
+    return true;
+}
+
+void RewindBuffer::DecodeDelta(const uint8_t* delta, size_t deltaSize, const State& keyframe,
+                               State& state) {
+    state = keyframe;
+
+    size_t pos = 0;
+    size_t i = 0;
+    while (pos < deltaSize) {
+        i += ReadRunLength(delta, pos);
+        const size_t diffLength = ReadRunLength(delta, pos);
+        ASSERT(i + diffLength <= state.size() && pos + diffLength <= deltaSize);
+        for (size_t j = 0; j < diffLength; ++j)
+            state[i++] ^= delta[pos++];
+    }
+}
+
+size_t RewindBuffer::FrameMemory(const Frame& frame) {
+    return frame.deltaSize == 0 ? frame.keyframe->size() : frame.deltaSize;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Base.h"
+#include "CircularBuffer.h"
+#include <memory>
+#include <vector>
+
+// Keeps the last maxFrames save-states, one per frame, to step back through. Every
+// KeyframeInterval frames, a state is stored in full as a keyframe; the ones in between are stored
+// as the XOR against their keyframe, run-length encoded. States barely change from one frame to
+// the next, so these deltas are mostly runs of zeroes, and take a fraction of the space.
+//
+// All storage is allocated by Init, so that pushing never allocates: keyframes come from a pool
+// with enough of them for maxFrames, and deltas are packed into one ring of bytes. A delta that
+// doesn't fit in the ring is stored as a keyframe instead, and if no keyframe is free, the oldest
+// frames are dropped early until one is.
+class RewindBuffer {
+public:
+    static constexpr size_t KeyframeInterval = 60;
+
+    // Allocates storage for maxFrames states of stateSize bytes, with deltaStorageSize bytes for
+    // all the deltas
+    void Init(size_t maxFrames, size_t stateSize, size_t deltaStorageSize);
+    void Clear();
+
+    // Adds state as the latest frame, dropping the oldest one if full
+    void Push(const std::vector<uint8_t>& state);
+
+    // Removes the latest frame, and returns its state. Returns false if empty.
+    bool Pop(std::vector<uint8_t>& state);
+
+    size_t NumFrames() const { return m_frames.UsedSize(); }
+
+    // Bytes used by stored keyframes and deltas, for display. Keyframes that are only kept alive
+    // by deltas after their own frame was dropped aren't counted.
+    size_t MemoryUsed() const { return m_memoryUsed; }
+
+private:
+    using State = std::vector<uint8_t>;
+
+    struct Frame {
+        // Shared by every frame that refers to it, so it outlives dropping the keyframe itself
+        std::shared_ptr<State> keyframe;
+        size_t deltaOffset = 0; // In m_deltaStorage
+        size_t deltaSize = 0;   // 0 for the keyframe itself
+    };
+
+    // Returns false if the delta wouldn't be smaller than the state itself
+    static bool EncodeDelta(const State& state, const State& keyframe, State& delta);
+    static void DecodeDelta(const uint8_t* delta, size_t deltaSize, const State& keyframe,
+                            State& state);
+
+    static size_t FrameMemory(const Frame& frame);
+
+    void DropOldestFrame();
+    std::shared_ptr<State> FreeKeyframe();
+
+    // Finds room for size bytes after the last delta in m_deltaStorage. Returns false if there's
+    // none before reaching the first delta.
+    bool AllocateDelta(size_t size, size_t& offset);
+
+    CircularBuffer<Frame> m_frames;
+    std::vector<std::shared_ptr<State>> m_keyframes; // Pool, free when only referenced from here
+    std::shared_ptr<State> m_keyframe;               // Keyframe of the next delta
+    State m_encodedDelta;                            // Scratch space for encoding
+
+    // Ring of the stored deltas, in the order of their frames, from m_deltaBegin up to m_deltaEnd.
+    // A delta that doesn't fit before the end of the storage starts back at 0 instead.
+    State m_deltaStorage;
+    size_t m_deltaBegin = 0;
+    size_t m_deltaEnd = 0;
+    size_t m_numDeltas = 0;
+
+    size_t m_framesSinceKeyframe = 0;
+    size_t m_memoryUsed = 0;
+};
@@ -1,8 +1,10 @@
 #include "SDLEngine.h"
 
+#include "AllocationCounter.h"
 #include "ConsoleOutput.h"
 #include "EngineClient.h"
 #include "FileSystem.h"
+#include "FileSystemUtil.h"
 #include "GLRender.h"
 #include "GLUtil.h"
 #include "Gui.h"
@@ -17,6 +19,7 @@
 #include <chrono>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <unordered_map>
 
 // Include SDL_syswm.h for SDL_GetWindowWMInfo
@@ -44,35 +47,21 @@ namespace {
         enum Type { Game, Menu, Size };
     }
     bool g_paused[PauseSource::Size]{};
+    bool g_fastForwardEnabled{}; // Toggled from the menu, as opposed to held down
     double g_fps{};
+    double g_emulationSpeed{}; // Emulated seconds per real second
+    uint64_t g_allocationsLastFrame{}; // Should be 0 once running, as buffers are kept across frames
+
+    // While fast-forwarding, frames are emulated this much time at once, and we emulate frames for
+    // about this much real time per host frame
+    const double FastForwardFrameTime = 1.0 / 60.0;
+    const int RewindFramesPerStep = 2; // Rewind at twice the speed of play
 
     template <typename T>
     constexpr T MsToSec(T ms) {
         return static_cast<T>(ms / 1000.0);
     }
 
-    bool FindAndSetRootPath(fs::path exePath) {
-        // Look for bios file in current directory and up parent dirs
-        // and set current working directory to the one found.
-        const char* biosRomFile = "bios_rom.bin";
-
-        auto currDir = exePath.remove_filename();
-
-        do {
-            auto path = currDir / biosRomFile;
-
-            if (fs::exists(currDir / biosRomFile)) {
-                fs::current_path(currDir);
-                Printf("Root path set to: %s\n", fs::current_path().string().c_str());
-                return true;
-            }
-            currDir = currDir.parent_path();
-        } while (!currDir.empty());
-
-        Errorf("Bios rom file not found: %s", biosRomFile);
-        return false;
-    }
-
     Platform::WindowHandle GetMainWindowHandle() {
         SDL_SysWMinfo info{};
         SDL_GetWindowWMInfo(g_window, &info);
@@ -301,18 +290,59 @@ namespace {
         return false;
     }
 
-    void UpdateTurboMode(bool& turbo) {
-        turbo = false;
+    bool IsFastForwarding() {
+        if (g_fastForwardEnabled || g_keyboard.GetKeyState(SDL_SCANCODE_GRAVE).down)
+            return true;
 
-        if (g_keyboard.GetKeyState(SDL_SCANCODE_GRAVE).down) {
-            turbo = true;
+        for (auto& kvp : g_playerIndexToGamepad) {
+            auto& gamepad = kvp.second;
+            if (gamepad.GetAxisValue(SDL_CONTROLLER_AXIS_RIGHTX) > 16000)
+                return true;
         }
+        return false;
+    }
+
+    bool IsRewinding() {
+        if (g_keyboard.GetKeyState(SDL_SCANCODE_BACKSPACE).down)
+            return true;
 
         for (auto& kvp : g_playerIndexToGamepad) {
             auto& gamepad = kvp.second;
-            if (gamepad.GetAxisValue(SDL_CONTROLLER_AXIS_RIGHTX) > 16000)
-                turbo = true;
+            if (gamepad.GetAxisValue(SDL_CONTROLLER_AXIS_RIGHTX) < -16000)
+                return true;
+        }
+        return false;
+    }
+
+    void UpdateEmulationSpeed(double emulatedTime) {
+        static auto lastTime = std::chrono::high_resolution_clock::now();
+        const auto currTime = std::chrono::high_resolution_clock::now();
+        const std::chrono::duration<double> diff = currTime - lastTime;
+        lastTime = currTime;
+
+        static double totalEmulatedTime = 0;
+        static double elapsedTime = 0;
+        totalEmulatedTime += emulatedTime;
+        elapsedTime += diff.count();
+        if (elapsedTime >= 1) {
+            g_emulationSpeed = totalEmulatedTime / elapsedTime;
+            totalEmulatedTime = 0;
+            elapsedTime = 0;
+        }
+    }
+
+    // Squeezes samples produced over emulatedTime into frameTime worth of samples by keeping evenly
+    // spaced ones, which speeds up (and pitches up) the audio to match the emulation speed
+    void TimeStretchSamples(std::vector<float>& samples, double emulatedTime, double frameTime) {
+        if (frameTime <= 0 || emulatedTime <= frameTime)
+            return;
+
+        const double step = emulatedTime / frameTime;
+        const size_t numSamples = static_cast<size_t>(samples.size() / step);
+        for (size_t i = 0; i < numSamples; ++i) {
+            samples[i] = samples[static_cast<size_t>(i * step)];
         }
+        samples.resize(numSamples);
     }
 
     void HACK_Simulate3dImager(double frameTime, Input& input) {
@@ -372,7 +402,7 @@ void SDLEngine::RegisterClient(IEngineClient& client) {
 }
 
 bool SDLEngine::Run(int argc, char** argv) {
-    if (!FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
+    if (!FileSystemUtil::FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
         return false;
 
     if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER) < 0) {
@@ -394,6 +424,8 @@ bool SDLEngine::Run(int argc, char** argv) {
     g_options.Add<bool>("enableGLDebugging", false);
     g_options.Add<float>("imguiFontScale", GetDefaultImguiFontScale());
     g_options.Add<std::string>("lastOpenedFile", {});
+    g_options.Add<float>("fastForwardSpeed", 0.f); // Max speed multiplier, 0 for unlimited
+    g_options.Add<bool>("fastForwardRenderAllFrames", false);
     g_options.SetFilePath(fs::absolute("options.txt"));
     g_options.Load();
 
@@ -462,6 +494,7 @@ bool SDLEngine::Run(int argc, char** argv) {
 
     g_audioDriver.Initialize();
 
+    g_client->SetRewindEnabled(true);
     if (!g_client->Init(argc, argv)) {
         return false;
     }
@@ -476,6 +509,8 @@ bool SDLEngine::Run(int argc, char** argv) {
 
     bool quit = false;
     while (!quit) {
+        const auto allocationsAtFrameStart = AllocationCounter::Count();
+
         PollEvents(quit);
         UpdatePauseState(g_paused[PauseSource::Game]);
         auto input = UpdateInput();
@@ -504,22 +539,100 @@ bool SDLEngine::Run(int argc, char** argv) {
             emuEvents.push_back({EmuEvent::OpenRomFile{}});
         }
 
+        // Function keys rather than Ctrl+S/L, as S is a joystick button
+        if (g_keyboard.GetKeyState(SDL_SCANCODE_F5).pressed) {
+            emuEvents.push_back({EmuEvent::SaveState{}});
+        }
+
+        if (g_keyboard.GetKeyState(SDL_SCANCODE_F9).pressed) {
+            emuEvents.push_back({EmuEvent::LoadState{}});
+        }
+
+        // Steps back every host frame, even when paused
+        const bool rewinding = IsRewinding();
+        if (rewinding) {
+            emuEvents.push_back({EmuEvent::Rewind{RewindFramesPerStep}});
+        }
+
         ImGui_ImplSdlGL3_NewFrame(g_window);
 
         UpdateMenu(quit, emuEvents);
+        GLRender::UpdateImGui();
 
         HACK_Simulate3dImager(frameTime, input);
 
-        if (!g_client->FrameUpdate(frameTime, input, {std::ref(emuEvents), std::ref(g_options)},
-                                   renderContext, audioContext))
-            quit = true;
+        if (frameTime > 0 && !rewinding && IsFastForwarding()) {
+            // Emulate as many frames as we can within a host frame, or until we're at the max
+            // speed multiplier, if set. Only the last frame is rendered by default.
+            const double maxSpeed = g_options.Get<float>("fastForwardSpeed");
+            const bool renderAllFrames = g_options.Get<bool>("fastForwardRenderAllFrames");
+            const double maxEmulatedTime =
+                maxSpeed > 0 ? frameTime * maxSpeed : std::numeric_limits<double>::max();
+
+            // The emulator's debug window widgets are only submitted by the first emulated frame,
+            // as ImGui expects each widget once per host frame
+            auto enabledWindows = Gui::EnabledWindows;
+            bool firstFrame = true;
+
+            const auto startTime = std::chrono::high_resolution_clock::now();
+            double emulatedTime = 0;
+            while (!quit && emulatedTime < maxEmulatedTime) {
+                const double emuFrameTime =
+                    std::min(FastForwardFrameTime, maxEmulatedTime - emulatedTime);
+                renderContext.lines.clear();
+
+                if (!g_client->FrameUpdate(emuFrameTime, input,
+                                           {std::ref(emuEvents), std::ref(g_options)},
+                                           renderContext, audioContext))
+                    quit = true;
+
+                emuEvents.clear();
+                emulatedTime += emuFrameTime;
+
+                if (firstFrame) {
+                    firstFrame = false;
+                    enabledWindows = Gui::EnabledWindows;
+                    Gui::EnabledWindows.fill(false);
+                }
+
+                const std::chrono::duration<double> elapsed =
+                    std::chrono::high_resolution_clock::now() - startTime;
+                const bool lastFrame = elapsed.count() >= FastForwardFrameTime;
+
+                if (renderAllFrames || lastFrame || emulatedTime >= maxEmulatedTime)
+                    GLRender::RenderScene(emuFrameTime, renderContext);
+
+                if (lastFrame)
+                    break;
+            }
+
+            Gui::EnabledWindows = enabledWindows;
+
+            TimeStretchSamples(audioContext.samples, emulatedTime, frameTime);
+            UpdateEmulationSpeed(emulatedTime);
+
+        } else {
+            // Lines are otherwise kept while paused
+            if (rewinding)
+                renderContext.lines.clear();
+
+            if (!g_client->FrameUpdate(frameTime, input,
+                                       {std::ref(emuEvents), std::ref(g_options)}, renderContext,
+                                       audioContext))
+                quit = true;
+
+            GLRender::RenderScene(frameTime, renderContext);
+            UpdateEmulationSpeed(frameTime);
+        }
 
         // Audio update
         g_audioDriver.AddSamples(audioContext.samples.data(), audioContext.samples.size());
         audioContext.samples.clear();
         g_audioDriver.Update(frameTime);
 
-        GLRender::RenderScene(frameTime, renderContext);
+        IMGUI_CALL(Debug, ImGui::Text("Heap allocations last frame: %llu",
+                                      (unsigned long long)g_allocationsLastFrame));
+
         ImGui_Render();
         SDL_GL_SwapWindow(g_window);
 
@@ -532,6 +645,8 @@ bool SDLEngine::Run(int argc, char** argv) {
         for (auto& kvp : g_playerIndexToGamepad) {
             kvp.second.PostFrameUpdateStates();
         }
+
+        g_allocationsLastFrame = AllocationCounter::Count() - allocationsAtFrameStart;
     }
 
     g_client->Shutdown();
@@ -639,12 +754,6 @@ double SDLEngine::UpdateFrameTime() {
     if (IsPaused())
         frameTime = 0.0;
 
-    // Scale up if turbo
-    static bool turbo = false;
-    UpdateTurboMode(turbo);
-    if (turbo)
-        frameTime *= 10;
-
     return frameTime;
 }
 
@@ -681,8 +790,19 @@ void SDLEngine::UpdateMenu(bool& quit, EmuEvents& emuEvents) {
             if (ImGui::MenuItem("Reset", "Ctrl+R"))
                 emuEvents.push_back({EmuEvent::Reset{}});
 
+            if (ImGui::MenuItem("Quick save state", "F5"))
+                emuEvents.push_back({EmuEvent::SaveState{}});
+
+            if (ImGui::MenuItem("Quick load state", "F9"))
+                emuEvents.push_back({EmuEvent::LoadState{}});
+
             ImGui::MenuItem("Pause", "P", &g_paused[PauseSource::Game]);
 
+            ImGui::MenuItem("Fast forward", "Hold `", &g_fastForwardEnabled);
+
+            // Only shows the binding, as it has to be held down
+            ImGui::MenuItem("Rewind", "Hold Backspace", false, false);
+
             ImGui::EndMenu();
         }
 
@@ -709,8 +829,8 @@ void SDLEngine::UpdateMenu(bool& quit, EmuEvents& emuEvents) {
             ImGui::SameLine(ImGui::GetWindowContentRegionMax().x - ImGui::CalcTextSize(text).x);
             ImGui::LabelText("", text);
         };
-        RightAlignLabelText(
-            FormattedString<>("%.2f FPS (%.2f ms)", g_fps, g_fps > 0 ? (1000.f / g_fps) : 0.f));
+        RightAlignLabelText(FormattedString<>("%.2fx %.2f FPS (%.2f ms)", g_emulationSpeed, g_fps,
+                                              g_fps > 0 ? (1000.f / g_fps) : 0.f));
 
         ImGui::EndMainMenuBar();
 
@@ -1,25 +1,35 @@
 #include "Screen.h"
 #include "EngineClient.h"
 #include "Gui.h"
-
-namespace {
-    //@TODO: make these conditionally const for "shipping" build
-    int32_t RampUpDelay = 5;
-    int32_t RampDownDelay = 10;
-    int32_t VelocityXDelay = 6;
-    // LineDrawScale is required because introducing ramp and velX delays means we now create lines
-    // that go outside the 256x256 grid. So we scale down the line drawing values a little to make
-    // it fit within the grid again.
-    float LineDrawScale = 0.85f;
-} // namespace
+#include <algorithm>
+#include <limits>
 
 void Screen::Init() {
-    m_velocityX.CyclesToUpdateValue = VelocityXDelay;
+    m_velocityX.CyclesToUpdateValue = m_velocityXDelay;
 }
 
 void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
-    m_velocityX.Update(cycles);
-    m_velocityY.Update(cycles);
+    // Step one cycle at a time while the ramp or velocities are changing, and integrate the spans
+    // of cycles in between in one go
+    while (cycles > 0) {
+        UpdateCycle(renderContext);
+        --cycles;
+
+        const cycles_t span = std::min(cycles, SteadyCycles());
+        if (span > 0) {
+            UpdateSpan(span, renderContext);
+            cycles -= span;
+        }
+    }
+}
+
+void Screen::UpdateCycle(RenderContext& renderContext) {
+    // While zero is enabled, the beam is held at the origin
+    if (m_zeroEnabled)
+        ZeroBeam();
+
+    m_velocityX.Update(1);
+    m_velocityY.Update(1);
 
     // Handle switching to RampUp/RampDown
     switch (m_rampPhase) {
@@ -27,7 +37,7 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
     case RampPhase::RampDown:
         if (m_integratorsEnabled) {
             m_rampPhase = RampPhase::RampUp;
-            m_rampDelay = RampUpDelay;
+            m_rampDelay = m_rampUpDelay;
         }
         break;
 
@@ -35,7 +45,7 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
     case RampPhase::RampUp:
         if (!m_integratorsEnabled) {
             m_rampPhase = RampPhase::RampDown;
-            m_rampDelay = RampDownDelay;
+            m_rampDelay = m_rampDownDelay;
         }
     }
 
@@ -56,54 +66,133 @@ void Screen::Update(cycles_t cycles, RenderContext& renderContext) {
     }
 
     const auto lastPos = m_pos;
-    const Vector2 currDir = Normalized({m_velocityX, m_velocityY});
-
-    if (Magnitude({m_velocityX, m_velocityY}) == 0.f) {
-        int a = 0;
-        a = a;
+    const Vector2 delta = CycleDelta();
+    if (!(delta == m_dirDelta)) {
+        m_dirDelta = delta;
+        m_dir = Normalized(delta);
     }
 
     // Move beam while ramp is on or its way down
     switch (m_rampPhase) {
     case RampPhase::RampDown:
-    case RampPhase::RampOn: {
-        const auto offset = Vector2{m_xyOffset, m_xyOffset};
-        Vector2 velocity{m_velocityX, m_velocityY};
-        Vector2 delta = (velocity + offset) / 128.f * static_cast<float>(cycles) * LineDrawScale;
-        m_pos += delta;
+    case RampPhase::RampOn:
+        MoveBeam(1);
         break;
     }
-    }
 
-    // We might draw even when integrators are disabled (e.g. drawing dots)
+    // We might draw even when integrators are disabled (e.g. drawing dots). Keep extending the
+    // last line for as long as the beam moves in the same direction, velocity and offset included,
+    // so that the line follows the path swept. When the beam doesn't move (a zero direction),
+    // extending leaves the line as is, which also merges successive dots.
     bool drawingEnabled = !m_blank && (m_brightness > 0.f && m_brightness <= 128.f);
     if (drawingEnabled) {
-        if (m_lastDrawingEnabled && (Magnitude(m_lastDir) > 0.f) && (m_lastDir == currDir) &&
-            !renderContext.lines.empty()) {
-            renderContext.lines.back().p1 = m_pos;
-        } else {
-            renderContext.lines.emplace_back(Line{lastPos, m_pos, m_brightness / 128.f});
+        const Line line{lastPos, m_pos, m_brightness / 128.f};
+        auto& lines = renderContext.lines;
+
+        if (m_lastDrawingEnabled && (m_lastDir == m_dir) && !lines.empty()) {
+            lines.back().p1 = m_pos;
+        } else if (lines.empty() || !(lines.back().p0 == line.p0 && lines.back().p1 == line.p1 &&
+                                      lines.back().brightness == line.brightness)) {
+            // While zeroing, we'd otherwise add the same line every cycle
+            lines.emplace_back(line);
         }
     }
 
     m_lastDrawingEnabled = drawingEnabled;
-    m_lastDir = currDir;
+    m_lastDir = m_dir;
+}
+
+cycles_t Screen::SteadyCycles() const {
+    // Ramp phase changes when integrators are toggled, or when the ramp delay runs out
+    cycles_t result = std::numeric_limits<cycles_t>::max();
+    switch (m_rampPhase) {
+    case RampPhase::RampOff:
+        if (m_integratorsEnabled)
+            return 0;
+        break;
+    case RampPhase::RampOn:
+        if (!m_integratorsEnabled)
+            return 0;
+        break;
+    case RampPhase::RampUp:
+        if (!m_integratorsEnabled)
+            return 0;
+        result = static_cast<cycles_t>(std::max(m_rampDelay - 1, 0));
+        break;
+    case RampPhase::RampDown:
+        if (m_integratorsEnabled)
+            return 0;
+        result = static_cast<cycles_t>(std::max(m_rampDelay - 1, 0));
+        break;
+    }
+
+    // Velocities change the cycle their delayed value comes in
+    for (auto cyclesLeft : {m_velocityX.CyclesLeft(), m_velocityY.CyclesLeft()}) {
+        if (cyclesLeft > 0)
+            result = std::min(result, cyclesLeft - 1);
+    }
+    return result;
+}
+
+// Same result as calling UpdateCycle once per cycle, given UpdateCycle was called right before,
+// and the span doesn't exceed SteadyCycles(). Only beam position changes: it moves the same delta
+// every cycle, and whatever's being drawn extends the last line (zeroing redraws the same line).
+void Screen::UpdateSpan(cycles_t cycles, RenderContext& renderContext) {
+    m_velocityX.Update(cycles);
+    m_velocityY.Update(cycles);
+
+    if (m_rampPhase == RampPhase::RampUp || m_rampPhase == RampPhase::RampDown)
+        m_rampDelay -= static_cast<int32_t>(cycles);
+
+    if (m_zeroEnabled)
+        return;
+
+    if (m_rampPhase == RampPhase::RampOn || m_rampPhase == RampPhase::RampDown)
+        MoveBeam(cycles);
+
+    if (m_lastDrawingEnabled)
+        renderContext.lines.back().p1 = m_pos;
+}
+
+void Screen::Serialize(Serializer& s) {
+    s.Serialize(m_integratorsEnabled, m_pos, m_rawPosX, m_rawPosY, m_lastDrawingEnabled, m_lastDir, m_dirDelta, m_dir);
+    m_velocityX.Serialize(s);
+    m_velocityY.Serialize(s);
+    s.Serialize(m_xyOffset, m_brightness, m_blank, m_zeroEnabled, m_rampPhase, m_rampDelay);
+}
+
+Vector2 Screen::CycleDelta() const {
+    const auto offset = Vector2{m_xyOffset, m_xyOffset};
+    Vector2 velocity{m_velocityX, m_velocityY};
+    return (velocity + offset) / 128.f * m_lineDrawScale;
+}
+
+void Screen::MoveBeam(cycles_t cycles) {
+    // Velocities and offset are whole numbers, so this is exact
+    const auto n = static_cast<int64_t>(cycles);
+    m_rawPosX += static_cast<int64_t>(m_velocityX + m_xyOffset) * n;
+    m_rawPosY += static_cast<int64_t>(m_velocityY + m_xyOffset) * n;
+    const Vector2 rawPos{static_cast<float>(m_rawPosX), static_cast<float>(m_rawPosY)};
+    m_pos = rawPos / 128.f * m_lineDrawScale;
 }
 
 void Screen::FrameUpdate(double /*frameTime*/) {
-    static bool ScreenImGui = false;
-    IMGUI_CALL(Debug, ImGui::Checkbox("<<< Screen >>>", &ScreenImGui));
-
-    IMGUI_CALL_IF(ScreenImGui, Debug, ImGui::SliderInt("RampUpDelay", &RampUpDelay, 0, 20));
-    IMGUI_CALL_IF(ScreenImGui, Debug, ImGui::SliderInt("RampDownDelay", &RampDownDelay, 0, 20));
-    IMGUI_CALL_IF(ScreenImGui, Debug, ImGui::SliderInt("VelocityXDelay", &VelocityXDelay, 0, 30));
-    IMGUI_CALL_IF(ScreenImGui, Debug,
-                  ImGui::SliderFloat("LineDrawScale", &LineDrawScale, 0.1f, 1.f));
-    m_velocityX.CyclesToUpdateValue = VelocityXDelay;
+    IMGUI_CALL(Debug, ImGui::Checkbox("<<< Screen >>>", &m_imGuiEnabled));
+
+    IMGUI_CALL_IF(m_imGuiEnabled, Debug,
+                  ImGui::SliderInt("RampUpDelay", &m_rampUpDelay, 0, 20));
+    IMGUI_CALL_IF(m_imGuiEnabled, Debug,
+                  ImGui::SliderInt("RampDownDelay", &m_rampDownDelay, 0, 20));
+    IMGUI_CALL_IF(m_imGuiEnabled, Debug,
+                  ImGui::SliderInt("VelocityXDelay", &m_velocityXDelay, 0, 30));
+    IMGUI_CALL_IF(m_imGuiEnabled, Debug,
+                  ImGui::SliderFloat("LineDrawScale", &m_lineDrawScale, 0.1f, 1.f));
+    m_velocityX.CyclesToUpdateValue = m_velocityXDelay;
 }
 
 void Screen::ZeroBeam() {
     //@TODO: move beam towards 0,0 over time
     m_pos = {0.f, 0.f};
+    m_rawPosX = m_rawPosY = 0;
     m_lastDrawingEnabled = false;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "DelayedValueStore.h"
+#include "Serializer.h"
 #include "Vector2.h"
 
 struct RenderContext;
@@ -13,7 +14,7 @@ public:
     void Update(cycles_t cycles, RenderContext& renderContext);
     void FrameUpdate(double frameTime);
 
-    void ZeroBeam();
+    void SetZeroEnabled(bool enabled) { m_zeroEnabled = enabled; }
     void SetBlankEnabled(bool enabled) { m_blank = enabled; }
     void SetIntegratorsEnabled(bool enabled) { m_integratorsEnabled = enabled; }
     void SetIntegratorX(int8_t value) { m_velocityX = value; }
@@ -21,18 +22,47 @@ public:
     void SetIntegratorXYOffset(int8_t value) { m_xyOffset = value; }
     void SetBrightness(uint8_t value) { m_brightness = value; }
 
+    void Serialize(Serializer& s);
+
 private:
+    void ZeroBeam();
+    void UpdateCycle(RenderContext& renderContext);
+    void UpdateSpan(cycles_t cycles, RenderContext& renderContext);
+    // Number of cycles after the current one during which only the beam position changes
+    cycles_t SteadyCycles() const;
+    Vector2 CycleDelta() const;
+    void MoveBeam(cycles_t cycles);
+
     bool m_integratorsEnabled{};
     Vector2 m_pos;
+    // Beam position in units of the integrators' input (velocity plus offset), which is summed
+    // exactly, so that the position doesn't depend on how cycles were split into spans
+    int64_t m_rawPosX = 0;
+    int64_t m_rawPosY = 0;
 
     bool m_lastDrawingEnabled{};
     Vector2 m_lastDir;
 
+    // Beam direction, only normalized again when the beam's per-cycle delta changes
+    Vector2 m_dirDelta;
+    Vector2 m_dir;
+
     DelayedValueStore<float> m_velocityX;
     DelayedValueStore<float> m_velocityY;
     float m_xyOffset = 0.f;
     float m_brightness = 0.f;
     bool m_blank = false;
+    bool m_zeroEnabled = false;
     enum class RampPhase { RampOff, RampUp, RampOn, RampDown } m_rampPhase = RampPhase::RampOff;
     int32_t m_rampDelay = 0;
+
+    //@TODO: make these conditionally const for "shipping" build
+    int32_t m_rampUpDelay = 5;
+    int32_t m_rampDownDelay = 10;
+    int32_t m_velocityXDelay = 6;
+    // m_lineDrawScale is required because introducing ramp and velX delays means we now create
+    // lines that go outside the 256x256 grid. So we scale down the line drawing values a little to
+    // make it fit within the grid again.
+    float m_lineDrawScale = 0.85f;
+    bool m_imGuiEnabled = false;
 };
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Base.h"
+#include "Stream.h"
+#include <type_traits>
+
+// Saves or loads state through a stream. Classes describe their state once, in a single
+// Serialize(Serializer&) function, which is used in both directions: when saving, values are
+// written out, and when loading, the same values are read back into place in the same order.
+class Serializer {
+public:
+    enum class Mode { Save, Load };
+
+    Serializer(IStream& stream, Mode mode)
+        : m_stream(stream)
+        , m_mode(mode) {}
+
+    bool Loading() const { return m_mode == Mode::Load; }
+
+    // False if any value failed to be read or written
+    bool Ok() const { return m_ok; }
+
+    // Values are written as is, so must not contain pointers or padding that differs between runs
+    template <typename T>
+    void Serialize(T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "Implement Serialize(Serializer&) for T");
+        if (Loading()) {
+            m_ok = m_stream.ReadValue(value) && m_ok;
+        } else {
+            m_ok = m_stream.WriteValue(value) == 1 && m_ok;
+        }
+    }
+
+    template <typename... Ts>
+    void Serialize(Ts&... values) {
+        (Serialize(values), ...);
+    }
+
+private:
+    IStream& m_stream;
+    Mode m_mode;
+    bool m_ok = true;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "Serializer.h"
 
 // The VIA's shift register, mainly responsible for driving the drawing of line patterns. It can be
 // loaded with an 8 bit mask that represents the pattern to be drawn, and although it's called a
@@ -17,11 +18,16 @@ public:
         // ($B).
         return true;
     }
+    bool Shifting() const { return m_shiftCyclesLeft > 0; }
     void Update(cycles_t cycles);
 
     void SetInterruptFlag(bool enabled) { m_interruptFlag = enabled; }
     bool InterruptFlag() const { return m_interruptFlag; }
 
+    void Serialize(Serializer& s) {
+        s.Serialize(m_value, m_shiftCyclesLeft, m_cb2Active, m_interruptFlag);
+    }
+
 private:
     uint8_t m_value = 0;
     mutable int m_shiftCyclesLeft = 0;
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Base.h"
+#include <atomic>
+#include <vector>
+
+// Fixed-size queue between a single producer thread and a single consumer thread, without locks.
+// Only the producer writes the tail index and only the consumer writes the head index, each stored
+// with release semantics once the slot it covers has been written or read. Each side also caches
+// the other side's index, so it only touches the other's cache line when the ring looks full or
+// empty.
+template <typename T>
+class SpscRing {
+public:
+    // Capacity is rounded up to a power of 2
+    explicit SpscRing(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity)
+            size *= 2;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    size_t Capacity() const { return m_slots.size(); }
+
+    // Producer: copies value into the ring. Returns false if full.
+    bool TryPush(const T& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_cachedHead == m_slots.size()) {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            if (tail - m_cachedHead == m_slots.size())
+                return false;
+        }
+        m_slots[tail & m_mask] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the oldest value, left in place to avoid a copy, or null if empty. Call PopFront
+    // once done with it.
+    T* Front() {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_cachedTail) {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            if (head == m_cachedTail)
+                return nullptr;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    // Consumer: releases the value returned by Front
+    void PopFront() {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    std::vector<T> m_slots;
+    size_t m_mask{};
+
+    // Written by the consumer
+    alignas(64) std::atomic<size_t> m_head{};
+    size_t m_cachedTail{};
+
+    // Written by the producer
+    alignas(64) std::atomic<size_t> m_tail{};
+    size_t m_cachedHead{};
+};
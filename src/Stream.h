@@ -106,7 +106,7 @@ public:
     }
 
 protected:
-    uint8_t* End() { return m_curr + m_size; }
+    uint8_t* End() { return m_buffer + m_size; }
 
     void CloseImpl() override {
         m_curr = nullptr;
@@ -131,7 +131,7 @@ protected:
         assert(m_curr + size <= End());
         std::copy_n((uint8_t*)source, size, m_curr);
         m_curr += size;
-        return size;
+        return count;
     }
 
     bool SetPosImpl(size_t pos) override {
@@ -167,7 +167,7 @@ protected:
 
     size_t WriteImpl(const void* /*source*/, size_t elemSize, size_t count) override {
         m_size += (elemSize * count);
-        return (elemSize * count);
+        return count;
     }
 
     bool SetPosImpl(size_t /*pos*/) override {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <sstream>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -84,3 +86,33 @@ inline std::string Replace(std::string_view s, std::string_view toReplace,
     result += s.substr(offset, s.size() - offset);
     return result;
 }
+
+template <typename T>
+T HexStringToIntegral(const char* s) {
+    std::stringstream converter(s);
+    int64_t value;
+    converter >> std::hex >> value;
+    return static_cast<T>(value);
+}
+
+template <typename T>
+T HexStringToIntegral(const std::string& s) {
+    return HexStringToIntegral<T>(s.c_str());
+}
+
+template <typename T>
+T StringToIntegral(std::string s) {
+    if (s.length() == 0)
+        return 0;
+
+    if (s[0] == '$') { // '$' Hex value
+        return HexStringToIntegral<T>(s.substr(1));
+    } else if (s[0] == '0' && s[1] == 'x' || s[1] == 'X') { // '0x' Hex value
+        return HexStringToIntegral<T>(s);
+    } else { // Integral value
+        int64_t value;
+        std::stringstream converter(s);
+        converter >> value;
+        return static_cast<T>(value);
+    }
+}
@@ -2,6 +2,46 @@
 
 #include "Base.h"
 
+#if defined(VECTREXY_HEADLESS)
+
+// Headless builds don't link against SDL_net, so server/client sync is not available
+class TcpServer {
+public:
+    void Open(uint16_t /*port*/) { FAIL_MSG("TcpServer not supported in headless builds"); }
+    void Close() {}
+    bool TryAccept() { return false; }
+
+    template <typename T>
+    bool Send(const T& /*value*/) {
+        return false;
+    }
+
+    template <typename T>
+    bool Receive(T& /*value*/) {
+        return false;
+    }
+};
+
+class TcpClient {
+public:
+    void Open(const char* /*ipAddress*/, uint16_t /*port*/) {
+        FAIL_MSG("TcpClient not supported in headless builds");
+    }
+    void Close() {}
+
+    template <typename T>
+    bool Send(const T& /*value*/) {
+        return false;
+    }
+
+    template <typename T>
+    bool Receive(T& /*value*/) {
+        return false;
+    }
+};
+
+#else
+
 //@TODO: get rid of this public dependency on SDL (pimpl or polymorphic type)
 #include <SDL_net.h>
 
@@ -91,3 +131,5 @@ private:
     TCPsocket m_socket{};
     IPaddress m_ip{};
 };
+
+#endif // defined(VECTREXY_HEADLESS)
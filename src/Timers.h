@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Base.h"
+#include "Serializer.h"
 
 enum class TimerMode { FreeRunning, OneShot, PulseCounting };
 
@@ -35,6 +36,8 @@ public:
 
     uint8_t ReadCounterHigh() const { return static_cast<uint8_t>(m_counter >> 8); }
 
+    uint16_t Counter() const { return m_counter; }
+
     void WriteLatchLow(uint8_t value) { WriteCounterLow(value); }
     void WriteLatchHigh(uint8_t value) { m_latchHigh = value; }
     uint8_t ReadLatchLow() const { return m_latchLow; }
@@ -58,6 +61,10 @@ public:
     bool PB7Flag() const { return m_pb7Flag; }
     bool PB7SignalLow() const { return m_pb7SignalLow; }
 
+    void Serialize(Serializer& s) {
+        s.Serialize(m_latchLow, m_latchHigh, m_counter, m_interruptFlag, m_pb7Flag, m_pb7SignalLow);
+    }
+
 private:
     uint8_t m_latchLow = 0;
     uint8_t m_latchHigh = 0;
@@ -104,6 +111,8 @@ public:
     void SetInterruptFlag(bool enabled) { m_interruptFlag = enabled; }
     bool InterruptFlag() const { return m_interruptFlag; }
 
+    void Serialize(Serializer& s) { s.Serialize(m_latchLow, m_counter, m_interruptFlag); }
+
 private:
     uint8_t m_latchLow = 0; // Note: Timer2 has no high-order latch
     uint16_t m_counter = 0;
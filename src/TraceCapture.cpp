@@ -0,0 +1,59 @@
+#include "TraceCapture.h"
+#include "TraceFile.h"
+#include <chrono>
+
+namespace {
+    // Empty polls of the ring after which the consumer thread sleeps between polls, so it doesn't
+    // keep a core busy while emulation is paused
+    const int MaxIdleSpins = 64;
+} // namespace
+
+TraceCapture::TraceCapture(size_t historySize)
+    : m_history(historySize) {
+    m_thread = std::thread([this] { ConsumerThread(); });
+}
+
+TraceCapture::~TraceCapture() {
+    Flush();
+    m_quit = true;
+    m_thread.join();
+    SetTraceFile(nullptr);
+}
+
+void TraceCapture::Flush() {
+    while (m_numProcessed.load(std::memory_order_acquire) != m_numPushed)
+        std::this_thread::yield();
+}
+
+void TraceCapture::SetTraceFile(std::unique_ptr<TraceFileWriter> traceFile) {
+    if (m_traceFile)
+        m_traceFile->Close();
+    m_traceFile = std::move(traceFile);
+}
+
+void TraceCapture::ConsumerThread() {
+    int idleSpins = 0;
+    while (!m_quit) {
+        InstructionTraceInfo* traceInfo = m_ring.Front();
+        if (!traceInfo) {
+            if (++idleSpins < MaxIdleSpins) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            continue;
+        }
+        idleSpins = 0;
+
+        if (m_traceFile)
+            m_traceFile->Write(*traceInfo);
+
+        if (m_hashEnabled)
+            m_hasher.Add(*traceInfo);
+
+        m_history.PushBackMoveFront(*traceInfo);
+        m_ring.PopFront();
+
+        m_numProcessed.fetch_add(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Base.h"
+#include "CircularBuffer.h"
+#include "InstructionHasher.h"
+#include "InstructionTrace.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+class TraceFileWriter;
+
+// Processes traced instructions on a consumer thread: keeps the most recent ones for the debugger's
+// trace command, writes them to a trace file if any, and hashes them for sync mode. All the
+// emulation thread does per instruction is copy it into a lock-free ring.
+class TraceCapture {
+public:
+    static const size_t RingSize = 16 * 1024;
+
+    explicit TraceCapture(size_t historySize);
+    ~TraceCapture();
+
+    // Emulation thread: queues the instruction for processing, waiting if the consumer thread is
+    // RingSize instructions behind
+    void Push(const InstructionTraceInfo& traceInfo) {
+        while (!m_ring.TryPush(traceInfo))
+            std::this_thread::yield();
+        ++m_numPushed;
+    }
+
+    // Waits until every pushed instruction has been processed. Everything below is shared with the
+    // consumer thread, so must only be accessed after flushing, and before pushing again.
+    void Flush();
+
+    CircularBuffer<InstructionTraceInfo>& History() { return m_history; }
+
+    // Takes ownership of the open file, or closes the current one if null
+    void SetTraceFile(std::unique_ptr<TraceFileWriter> traceFile);
+    TraceFileWriter* TraceFile() { return m_traceFile.get(); }
+
+    void SetHashEnabled(bool enabled) { m_hashEnabled = enabled; }
+    bool HashEnabled() const { return m_hashEnabled; }
+
+    // Hashes every instruction processed while hashing is enabled
+    InstructionHasher& Hasher() { return m_hasher; }
+
+private:
+    void ConsumerThread();
+
+    SpscRing<InstructionTraceInfo> m_ring{RingSize};
+    uint64_t m_numPushed{}; // Only accessed by the emulation thread
+    std::atomic<uint64_t> m_numProcessed{};
+    std::atomic<bool> m_quit{};
+
+    CircularBuffer<InstructionTraceInfo> m_history;
+    std::unique_ptr<TraceFileWriter> m_traceFile;
+    bool m_hashEnabled{};
+    InstructionHasher m_hasher;
+
+    std::thread m_thread;
+};
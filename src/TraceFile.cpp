@@ -0,0 +1,326 @@
+#include "TraceFile.h"
+#include <cstdio>
+#include <utility>
+
+namespace {
+    // Record header byte
+    const uint8_t SizeMask = 0b0000'0111;   // Instruction size, including extra operand bytes
+    const uint8_t FetchesMask = 0b0011'1000; // Leading memory accesses that read the instruction
+    const int FetchesShift = 3;
+    const uint8_t PreRegistersFlag = 0b0100'0000; // Registers changed since the previous record
+
+    // Registers stored in a record, one bit each in the register mask, in storage order
+    enum RegisterBit : uint8_t {
+        X = 0x01,
+        Y = 0x02,
+        U = 0x04,
+        S = 0x08,
+        PC = 0x10,
+        D = 0x20,
+        DP = 0x40,
+        CC = 0x80,
+    };
+
+    // Cycles that don't fit in a byte are stored in full after this value
+    const uint8_t CyclesEscape = 0xFF;
+
+    void Put8(std::vector<uint8_t>& buffer, uint8_t value) { buffer.push_back(value); }
+
+    void Put16(std::vector<uint8_t>& buffer, uint16_t value) {
+        buffer.push_back(static_cast<uint8_t>(value & 0xFF));
+        buffer.push_back(static_cast<uint8_t>(value >> 8));
+    }
+
+    // Reads values from a block of bytes, failing once past the end
+    struct ByteReader {
+        const uint8_t* data;
+        size_t size;
+        size_t pos = 0;
+        bool ok = true;
+
+        uint8_t Get8() {
+            if (pos + 1 > size) {
+                ok = false;
+                return 0;
+            }
+            return data[pos++];
+        }
+
+        uint16_t Get16() {
+            uint16_t low = Get8();
+            return static_cast<uint16_t>(low | (Get8() << 8));
+        }
+    };
+
+    uint8_t ChangedRegisters(const CpuRegisters& prev, const CpuRegisters& curr,
+                             uint16_t expectedPC) {
+        uint8_t mask = 0;
+        mask |= prev.X != curr.X ? X : 0;
+        mask |= prev.Y != curr.Y ? Y : 0;
+        mask |= prev.U != curr.U ? U : 0;
+        mask |= prev.S != curr.S ? S : 0;
+        mask |= expectedPC != curr.PC ? PC : 0;
+        mask |= prev.D != curr.D ? D : 0;
+        mask |= prev.DP != curr.DP ? DP : 0;
+        mask |= prev.CC.Value != curr.CC.Value ? CC : 0;
+        return mask;
+    }
+
+    void PutRegisters(std::vector<uint8_t>& buffer, uint8_t mask, const CpuRegisters& regs) {
+        Put8(buffer, mask);
+        const std::pair<RegisterBit, uint16_t> words[] = {
+            {X, regs.X}, {Y, regs.Y}, {U, regs.U}, {S, regs.S}, {PC, regs.PC}, {D, regs.D}};
+        for (auto [bit, value] : words) {
+            if (mask & bit)
+                Put16(buffer, value);
+        }
+        if (mask & DP)
+            Put8(buffer, regs.DP);
+        if (mask & CC)
+            Put8(buffer, regs.CC.Value);
+    }
+
+    void GetRegisters(ByteReader& reader, CpuRegisters& regs) {
+        const uint8_t mask = reader.Get8();
+        const std::pair<RegisterBit, uint16_t*> words[] = {
+            {X, &regs.X}, {Y, &regs.Y}, {U, &regs.U}, {S, &regs.S}, {PC, &regs.PC}, {D, &regs.D}};
+        for (auto [bit, value] : words) {
+            if (mask & bit)
+                *value = reader.Get16();
+        }
+        if (mask & DP)
+            regs.DP = reader.Get8();
+        if (mask & CC)
+            regs.CC.Value = reader.Get8();
+    }
+} // namespace
+
+void TraceEncoder::Encode(const InstructionTraceInfo& traceInfo, std::vector<uint8_t>& buffer) {
+    const auto& instruction = traceInfo.instruction;
+    const auto& preRegs = traceInfo.preOpCpuRegisters;
+    const auto& postRegs = traceInfo.postOpCpuRegisters;
+    const size_t size = InstructionSize(instruction);
+
+    size_t numFetches = 0;
+    for (; numFetches < size && numFetches < traceInfo.numMemoryAccesses; ++numFetches) {
+        auto& ma = traceInfo.memoryAccesses[numFetches];
+        if (!ma.read || ma.address != static_cast<uint16_t>(preRegs.PC + numFetches) ||
+            ma.value != instruction.opBytes[numFetches])
+            break;
+    }
+
+    const uint8_t preMask = ChangedRegisters(m_prevRegisters, preRegs, m_prevRegisters.PC);
+    Put8(buffer, static_cast<uint8_t>(size | (numFetches << FetchesShift) |
+                                      (preMask ? PreRegistersFlag : 0)));
+    for (size_t i = 0; i < size; ++i)
+        Put8(buffer, instruction.opBytes[i]);
+
+    if (traceInfo.elapsedCycles < CyclesEscape) {
+        Put8(buffer, static_cast<uint8_t>(traceInfo.elapsedCycles));
+    } else {
+        Put8(buffer, CyclesEscape);
+        for (int i = 0; i < 8; ++i)
+            Put8(buffer, static_cast<uint8_t>(traceInfo.elapsedCycles >> (i * 8)));
+    }
+
+    if (preMask)
+        PutRegisters(buffer, preMask, preRegs);
+    const auto nextPC = static_cast<uint16_t>(preRegs.PC + size);
+    PutRegisters(buffer, ChangedRegisters(preRegs, postRegs, nextPC), postRegs);
+
+    const size_t numAccesses = traceInfo.numMemoryAccesses - numFetches;
+    Put8(buffer, static_cast<uint8_t>(numAccesses));
+    if (numAccesses > 0) {
+        uint16_t readMask = 0;
+        for (size_t i = 0; i < numAccesses; ++i)
+            readMask |= traceInfo.memoryAccesses[numFetches + i].read ? (1 << i) : 0;
+        Put16(buffer, readMask);
+        for (size_t i = 0; i < numAccesses; ++i) {
+            auto& ma = traceInfo.memoryAccesses[numFetches + i];
+            Put16(buffer, ma.address);
+            Put8(buffer, static_cast<uint8_t>(ma.value));
+        }
+    }
+
+    m_prevRegisters = postRegs;
+}
+
+size_t TraceDecoder::Decode(const uint8_t* data, size_t size, InstructionTraceInfo& traceInfo) {
+    ByteReader reader{data, size};
+
+    const uint8_t header = reader.Get8();
+    const size_t instructionSize = header & SizeMask;
+    const size_t numFetches = (header & FetchesMask) >> FetchesShift;
+    std::array<uint8_t, 5> opBytes{};
+    if (instructionSize == 0 || instructionSize > opBytes.size() || numFetches > instructionSize)
+        return 0;
+    for (size_t i = 0; i < instructionSize; ++i)
+        opBytes[i] = reader.Get8();
+    traceInfo.instruction = DecodeInstruction(opBytes);
+
+    traceInfo.elapsedCycles = reader.Get8();
+    if (traceInfo.elapsedCycles == CyclesEscape) {
+        traceInfo.elapsedCycles = 0;
+        for (int i = 0; i < 8; ++i)
+            traceInfo.elapsedCycles |= static_cast<cycles_t>(reader.Get8()) << (i * 8);
+    }
+
+    auto& preRegs = traceInfo.preOpCpuRegisters;
+    auto& postRegs = traceInfo.postOpCpuRegisters;
+    preRegs = m_prevRegisters;
+    if (header & PreRegistersFlag)
+        GetRegisters(reader, preRegs);
+    postRegs = preRegs;
+    postRegs.PC = static_cast<uint16_t>(preRegs.PC + instructionSize);
+    GetRegisters(reader, postRegs);
+
+    traceInfo.numMemoryAccesses = 0;
+    for (size_t i = 0; i < numFetches; ++i) {
+        traceInfo.AddMemoryAccess(static_cast<uint16_t>(preRegs.PC + i), opBytes[i], true);
+    }
+    const size_t numAccesses = reader.Get8();
+    if (numFetches + numAccesses > traceInfo.memoryAccesses.size())
+        return 0;
+    if (numAccesses > 0) {
+        const uint16_t readMask = reader.Get16();
+        for (size_t i = 0; i < numAccesses; ++i) {
+            const uint16_t address = reader.Get16();
+            traceInfo.AddMemoryAccess(address, reader.Get8(), (readMask & (1 << i)) != 0);
+        }
+    }
+
+    if (!reader.ok)
+        return 0;
+    m_prevRegisters = postRegs;
+    return reader.pos;
+}
+
+bool TraceFileWriter::Open(const char* file) {
+    Close();
+    if (!m_file.Open(file, "wb"))
+        return false;
+    m_file.WriteValue(TraceFile::Magic);
+    m_file.WriteValue(TraceFile::Version);
+
+    m_encoder = {};
+    m_chunk.clear();
+    m_chunk.reserve(ChunkSize + TraceFile::MaxRecordSize);
+    m_numRecords = 0;
+    m_numBytes = 0;
+    m_closing = false;
+    m_writeFailed = false;
+    m_thread = std::thread([this] { WriterThread(); });
+    return true;
+}
+
+bool TraceFileWriter::Close() {
+    if (!IsOpen())
+        return true;
+
+    SubmitChunk();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closing = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+    m_file.Close();
+    m_freeChunks.clear();
+    return !m_writeFailed;
+}
+
+void TraceFileWriter::Write(const InstructionTraceInfo& traceInfo) {
+    const size_t prevSize = m_chunk.size();
+    m_encoder.Encode(traceInfo, m_chunk);
+    m_numBytes += m_chunk.size() - prevSize;
+    ++m_numRecords;
+
+    if (m_chunk.size() >= ChunkSize)
+        SubmitChunk();
+}
+
+void TraceFileWriter::SubmitChunk() {
+    if (m_chunk.empty())
+        return;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_condition.wait(lock, [this] { return m_pendingChunks.size() < MaxPendingChunks; });
+    m_pendingChunks.push_back(std::move(m_chunk));
+
+    if (!m_freeChunks.empty()) {
+        m_chunk = std::move(m_freeChunks.back());
+        m_freeChunks.pop_back();
+    } else {
+        m_chunk = {};
+        m_chunk.reserve(ChunkSize + TraceFile::MaxRecordSize);
+    }
+    m_chunk.clear();
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+void TraceFileWriter::WriterThread() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_condition.wait(lock, [this] { return !m_pendingChunks.empty() || m_closing; });
+        if (m_pendingChunks.empty())
+            break; // Closing, and everything is written
+
+        auto chunk = std::move(m_pendingChunks.front());
+        m_pendingChunks.pop_front();
+        lock.unlock();
+        m_condition.notify_all();
+
+        const bool written = m_file.Write(chunk.data(), chunk.size()) == chunk.size();
+
+        lock.lock();
+        m_writeFailed = m_writeFailed || !written;
+        m_freeChunks.push_back(std::move(chunk));
+    }
+}
+
+bool TraceFileReader::Open(const char* file) {
+    if (!m_file.Open(file, "rb"))
+        return false;
+
+    uint32_t magic{}, version{};
+    if (!m_file.ReadValue(magic) || !m_file.ReadValue(version) || magic != TraceFile::Magic ||
+        version != TraceFile::Version) {
+        m_file.Close();
+        return false;
+    }
+
+    m_decoder = {};
+    m_buffer.clear();
+    m_bufferPos = 0;
+    m_corrupt = false;
+    return true;
+}
+
+bool TraceFileReader::Read(InstructionTraceInfo& traceInfo) {
+    if (!m_file.IsOpen() || m_corrupt)
+        return false;
+
+    // Keep at least a whole record in the buffer, unless at the end of the file
+    if (m_buffer.size() - m_bufferPos < TraceFile::MaxRecordSize) {
+        m_buffer.erase(m_buffer.begin(), m_buffer.begin() + m_bufferPos);
+        m_bufferPos = 0;
+        const size_t prevSize = m_buffer.size();
+        m_buffer.resize(prevSize + TraceFileWriter::ChunkSize);
+        const size_t numRead =
+            fread(m_buffer.data() + prevSize, 1, TraceFileWriter::ChunkSize, m_file.Get());
+        m_buffer.resize(prevSize + numRead);
+    }
+
+    if (m_bufferPos == m_buffer.size())
+        return false;
+
+    const size_t recordSize =
+        m_decoder.Decode(m_buffer.data() + m_bufferPos, m_buffer.size() - m_bufferPos, traceInfo);
+    if (recordSize == 0) {
+        m_corrupt = true;
+        return false;
+    }
+    m_bufferPos += recordSize;
+    return true;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Base.h"
+#include "InstructionTrace.h"
+#include "Stream.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Binary instruction trace files: a header followed by one variable-length record per executed
+// instruction. Records are delta-encoded: registers are only stored if they differ from the
+// previous instruction's (or, for PC, from the address of the next instruction), and the reads
+// of the instruction's own bytes aren't stored as memory accesses. Most records take around 10
+// bytes, compared to the few hundred of an InstructionTraceInfo.
+namespace TraceFile {
+    const uint32_t Magic = 0x52545856; // "VXTR"
+    const uint32_t Version = 1;
+
+    // Upper bound on the size of a single record
+    const size_t MaxRecordSize = 128;
+} // namespace TraceFile
+
+class TraceEncoder {
+public:
+    // Appends the record of traceInfo to buffer
+    void Encode(const InstructionTraceInfo& traceInfo, std::vector<uint8_t>& buffer);
+
+private:
+    CpuRegisters m_prevRegisters{};
+};
+
+class TraceDecoder {
+public:
+    // Decodes the record at the start of data into traceInfo. Returns the size of the record, or 0
+    // if data doesn't hold a valid record.
+    size_t Decode(const uint8_t* data, size_t size, InstructionTraceInfo& traceInfo);
+
+private:
+    CpuRegisters m_prevRegisters{};
+};
+
+// Streams records to a file on a background thread. Records are encoded into chunks on the calling
+// thread, and full chunks are handed to the writer thread. At most MaxPendingChunks are queued, and
+// Write waits for the thread to catch up beyond that, so memory use is bounded however long the
+// trace runs.
+class TraceFileWriter {
+public:
+    static const size_t ChunkSize = 64 * 1024;
+    static const size_t MaxPendingChunks = 16;
+
+    ~TraceFileWriter() { Close(); }
+
+    bool Open(const char* file);
+
+    // Writes out the remaining records and waits for the writer thread to finish. Returns false if
+    // any writes failed.
+    bool Close();
+
+    bool IsOpen() const { return m_thread.joinable(); }
+
+    void Write(const InstructionTraceInfo& traceInfo);
+
+    uint64_t NumRecords() const { return m_numRecords; }
+    uint64_t NumBytes() const { return m_numBytes; }
+
+private:
+    void SubmitChunk();
+    void WriterThread();
+
+    FileStream m_file;
+    TraceEncoder m_encoder;
+    std::vector<uint8_t> m_chunk;
+    uint64_t m_numRecords{};
+    uint64_t m_numBytes{};
+
+    // Shared with the writer thread
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<std::vector<uint8_t>> m_pendingChunks;
+    std::vector<std::vector<uint8_t>> m_freeChunks; // Written chunks, reused to avoid allocations
+    bool m_closing{};
+    bool m_writeFailed{};
+
+    std::thread m_thread;
+};
+
+class TraceFileReader {
+public:
+    // Returns false if the file can't be opened or isn't a trace file of this version
+    bool Open(const char* file);
+
+    // Reads the next record into traceInfo. Returns false at the end of the file, or if the next
+    // record is invalid (see Corrupt).
+    bool Read(InstructionTraceInfo& traceInfo);
+
+    bool Corrupt() const { return m_corrupt; }
+
+private:
+    FileStream m_file;
+    TraceDecoder m_decoder;
+    std::vector<uint8_t> m_buffer;
+    size_t m_bufferPos{};
+    bool m_corrupt{};
+};
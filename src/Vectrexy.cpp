@@ -0,0 +1,425 @@
+#include "Vectrexy.h"
+#include "ConsoleOutput.h"
+#include "CpuProfile.h"
+#include "FileSystemUtil.h"
+#include "HotSpotProfiler.h"
+#include "Platform.h"
+#include "Serializer.h"
+#include "Stream.h"
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace {
+    const uint32_t SaveStateMagic = 0x53535856; // "VXSS"
+    // Bump whenever the serialized state of any component changes
+    const uint32_t SaveStateVersion = 4;
+    const char* QuickSaveStateFile = "quicksave.state";
+
+    const size_t RewindBufferFrames = 5 * 60 * 60; // 5 minutes at 60 fps
+    // Average room for each frame's delta, about 1.5x what Mine Storm needs
+    const size_t RewindDeltaBytesPerFrame = 512;
+    const double RewindFrameTime = 1.0 / 60.0;
+
+    const int ProfileSampleInterval = 16;
+} // namespace
+
+bool Vectrexy::Init(int argc, char** argv) {
+    m_overlays.LoadOverlays();
+
+    std::string rom = "";
+    bool traceEnabled = true;
+    bool blockExecutionEnabled = false;
+    std::string recordMovieFile, playMovieFile, traceFile;
+    auto hashMode = InstructionHasher::Mode::Fast;
+    size_t hashGranularity = InstructionHasher::FrameGranularity;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-server") {
+            m_syncProtocol.InitServer();
+        } else if (arg == "-client") {
+            m_syncProtocol.InitClient();
+        } else if (arg == "-notrace") {
+            traceEnabled = false;
+        } else if (arg == "-blocks") {
+            blockExecutionEnabled = true;
+        } else if (arg == "-viapercycle") {
+            m_via.SetPerCycleStepping(true);
+        } else if (arg == "-psgpercycle") {
+            m_via.SetPsgPerCycleSampling(true);
+        } else if (arg == "-psgbandlimited") {
+            m_via.SetPsgBandLimited(true);
+        } else if (arg == "-seed" && i + 1 < argc) {
+            m_ramSeed = static_cast<unsigned int>(std::stoul(argv[++i]));
+        } else if (arg == "-recordmovie" && i + 1 < argc) {
+            recordMovieFile = argv[++i];
+        } else if (arg == "-playmovie" && i + 1 < argc) {
+            playMovieFile = argv[++i];
+        } else if (arg == "-tracefile" && i + 1 < argc) {
+            traceFile = argv[++i];
+        } else if (arg == "-hashmode" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            hashMode =
+                mode == "legacy" ? InstructionHasher::Mode::Legacy : InstructionHasher::Mode::Fast;
+        } else if (arg == "-hashgranularity" && i + 1 < argc) {
+            std::string granularity = argv[++i];
+            hashGranularity = granularity == "frame" ? InstructionHasher::FrameGranularity
+                                                     : std::stoul(granularity);
+        } else if (arg == "-profileops" && i + 1 < argc) {
+            m_profileOpsFile = argv[++i];
+        } else if (arg == "-profilehotspots" && i + 1 < argc) {
+            m_profileHotSpotsFile = argv[++i];
+        } else {
+            rom = arg;
+        }
+    }
+
+    // std::string rom = argc == 2 ? argv[1] : "";
+
+    m_cpu.Init(m_memoryBus);
+    m_via.Init(m_memoryBus);
+    m_ram.Init(m_memoryBus);
+    m_biosRom.Init(m_memoryBus);
+    m_illegal.Init(m_memoryBus);
+    m_cartridge.Init(m_memoryBus);
+    m_debugger.Init(m_memoryBus, m_cpu, m_via);
+    m_debugger.SetTraceEnabled(traceEnabled);
+    m_debugger.SetBlockExecutionEnabled(blockExecutionEnabled);
+    m_debugger.SetInstructionHashing(hashMode, hashGranularity);
+    if (!traceFile.empty() && !m_debugger.StartTraceFile(traceFile.c_str()))
+        Errorf("Failed to create trace file: %s\n", traceFile.c_str());
+    if (!m_profileOpsFile.empty())
+        m_cpu.SetProfilingEnabled(true, ProfileSampleInterval);
+    if (!m_profileHotSpotsFile.empty())
+        m_debugger.SetHotSpotProfilingEnabled(true);
+
+    m_biosRom.LoadBiosRom("bios_rom.bin");
+
+    if (!rom.empty()) {
+        if (!LoadRom(rom.c_str()) && m_romRequired)
+            return false;
+    } else {
+        // If no rom is loaded, we'll play the built-in Mine Storm
+        LoadOverlay("Minestorm");
+    }
+
+    // Instances in lockstep don't share a seed, so they leave RAM cleared to start from the same
+    // contents
+    m_randomizeRam = m_syncProtocol.IsStandalone();
+
+    // Movies start from power-on with the RAM contents they were recorded with
+    if (!playMovieFile.empty()) {
+        if (!m_inputMovie.OpenPlay(playMovieFile.c_str()))
+            return false;
+
+        const auto& header = m_inputMovie.GetHeader();
+        if (header.romHash != m_cartridge.RomHash()) {
+            Errorf("Movie was recorded with a different rom: %s\n", playMovieFile.c_str());
+            return false;
+        }
+        if (header.ramRandomized && !m_syncProtocol.IsStandalone()) {
+            Errorf("Movie starts from random RAM, which can't be played while syncing with another "
+                   "instance: %s\n",
+                   playMovieFile.c_str());
+            return false;
+        }
+        m_randomizeRam = header.ramRandomized != 0;
+        m_ramSeed = header.ramSeed;
+    } else if (!recordMovieFile.empty()) {
+        if (m_randomizeRam && !m_ramSeed)
+            m_ramSeed = std::random_device{}();
+
+        InputMovie::Header header;
+        header.romHash = m_cartridge.RomHash();
+        header.ramRandomized = m_randomizeRam;
+        header.ramSeed = m_ramSeed.value_or(0);
+        if (!m_inputMovie.OpenRecord(recordMovieFile.c_str(), header))
+            return false;
+    }
+
+    // Allocate all of the rewind history up front, sized after the state of the machine as set up
+    if (RewindAvailable()) {
+        SaveState(m_rewindState);
+        m_rewindBuffer.Init(RewindBufferFrames, m_rewindState.size(),
+                            RewindBufferFrames * RewindDeltaBytesPerFrame);
+    }
+
+    Reset();
+
+    return true;
+}
+
+void Vectrexy::Reset() {
+    m_cpu.Reset();
+    m_via.Reset();
+    m_ram.Reset();
+    m_debugger.Reset();
+
+    // Some games rely on initial random state of memory (e.g. Mine Storm)
+    if (m_randomizeRam) {
+        const unsigned int seed = m_ramSeed ? *m_ramSeed : std::random_device{}();
+        m_ram.Randomize(seed);
+    }
+}
+
+bool Vectrexy::LoadRom(const char* file) {
+    if (!m_cartridge.LoadRom(file)) {
+        Errorf("Failed to load rom file: %s\n", file);
+        return false;
+    }
+
+    m_cpu.InvalidateDecodeCache();
+
+    // Save-states don't include the rom
+    m_rewindBuffer.Clear();
+
+    //@TODO: Show game name in title bar
+
+    LoadOverlay(file);
+
+    return true;
+}
+
+void Vectrexy::LoadOverlay(const char* file) {
+    auto overlayPath = m_overlays.FindOverlay(file);
+    if (overlayPath) {
+        auto path = overlayPath->string();
+        Errorf("Found overlay for %s: %s\n", file, path.c_str());
+        ResetOverlay(path.c_str());
+    } else {
+        Errorf("No overlay found for %s\n", file);
+        ResetOverlay();
+    }
+}
+
+void Vectrexy::SerializeState(Serializer& s) {
+    uint32_t magic = SaveStateMagic;
+    uint32_t version = SaveStateVersion;
+    s.Serialize(magic, version);
+    if (magic != SaveStateMagic || version != SaveStateVersion)
+        return;
+
+    m_cpu.Serialize(s);
+    m_via.Serialize(s);
+    m_ram.Serialize(s);
+    m_debugger.Serialize(s);
+}
+
+std::vector<uint8_t> Vectrexy::SaveState() {
+    std::vector<uint8_t> state;
+    SaveState(state);
+    return state;
+}
+
+void Vectrexy::SaveState(std::vector<uint8_t>& state) {
+    ByteCounterStream counter;
+    Serializer counterSerializer(counter, Serializer::Mode::Save);
+    SerializeState(counterSerializer);
+
+    state.resize(counter.GetStreamSize());
+    MemoryStream stream;
+    stream.Open(state.data(), state.size());
+    Serializer serializer(stream, Serializer::Mode::Save);
+    SerializeState(serializer);
+    ASSERT(serializer.Ok());
+}
+
+bool Vectrexy::LoadState(const std::vector<uint8_t>& state) {
+    // Validate before touching any state: the header must match, and the size must be exactly
+    // that of the current version's state.
+    uint32_t magic{}, version{};
+    if (state.size() >= sizeof(magic) + sizeof(version)) {
+        std::memcpy(&magic, state.data(), sizeof(magic));
+        std::memcpy(&version, state.data() + sizeof(magic), sizeof(version));
+    }
+    if (magic != SaveStateMagic) {
+        Errorf("Not a save-state\n");
+        return false;
+    }
+    if (version != SaveStateVersion) {
+        Errorf("Unsupported save-state version %u (expected %u)\n", version, SaveStateVersion);
+        return false;
+    }
+
+    ByteCounterStream counter;
+    Serializer counterSerializer(counter, Serializer::Mode::Save);
+    SerializeState(counterSerializer);
+    if (state.size() != counter.GetStreamSize()) {
+        Errorf("Save-state size mismatch: %zu bytes (expected %zu)\n", state.size(),
+               counter.GetStreamSize());
+        return false;
+    }
+
+    MemoryStream stream;
+    stream.Open(const_cast<uint8_t*>(state.data()), state.size());
+    Serializer serializer(stream, Serializer::Mode::Load);
+    SerializeState(serializer);
+    ASSERT(serializer.Ok());
+    return true;
+}
+
+bool Vectrexy::SaveStateFile(const fs::path& path) {
+    auto state = SaveState();
+    FileStream fs;
+    if (!fs.Open(path.string().c_str(), "wb") ||
+        fs.Write(state.data(), state.size()) != state.size()) {
+        Errorf("Failed to write save-state file: %s\n", path.string().c_str());
+        return false;
+    }
+    Printf("Saved state to %s\n", path.string().c_str());
+    return true;
+}
+
+bool Vectrexy::LoadStateFile(const fs::path& path) {
+    std::error_code ec;
+    const auto size = fs::file_size(path, ec);
+    FileStream fs;
+    std::vector<uint8_t> state(ec ? 0 : static_cast<size_t>(size));
+    if (ec || !fs.Open(path.string().c_str(), "rb") || !fs.Read(state.data(), state.size())) {
+        Errorf("Failed to read save-state file: %s\n", path.string().c_str());
+        return false;
+    }
+    if (!LoadState(state)) {
+        Errorf("Failed to load save-state file: %s\n", path.string().c_str());
+        return false;
+    }
+    Printf("Loaded state from %s\n", path.string().c_str());
+    return true;
+}
+
+bool Vectrexy::Rewind(int numFrames) {
+    // The latest frame is the current state, and the frame before the target is loaded, so that
+    // emulating one frame from it lands on (and displays) the target frame
+    auto& state = m_rewindState;
+    state.clear();
+    for (int i = 0; i < numFrames + 2 && m_rewindBuffer.Pop(state); ++i) {
+    }
+    if (state.empty())
+        return false;
+
+    // Keep the oldest frame around to hold at it while rewinding further
+    if (m_rewindBuffer.NumFrames() == 0)
+        m_rewindBuffer.Push(state);
+
+    return LoadState(state);
+}
+
+bool Vectrexy::FrameUpdate(double frameTime, const Input& inputArg, const EmuContext& emuContext,
+                           RenderContext& renderContext, AudioContext& audioContext) {
+    Input input = inputArg;
+    EmuEvents& emuEvents = emuContext.emuEvents;
+    Options& options = emuContext.options;
+    bool rewound = false;
+
+    if (m_inputMovie.IsPlaying() && !m_inputMovie.PlayFrame(frameTime, input)) {
+        Printf("Movie playback finished after %llu frames\n",
+               (unsigned long long)m_inputMovie.NumFrames());
+        return false;
+    }
+
+    if (m_syncProtocol.IsServer()) {
+        m_syncProtocol.Server_SendFrameStart(frameTime, input);
+    } else if (m_syncProtocol.IsClient()) {
+        m_syncProtocol.Client_RecvFrameStart(frameTime, input);
+    }
+
+    if (m_inputMovie.IsRecording())
+        m_inputMovie.RecordFrame(frameTime, input);
+
+    for (auto& event : emuEvents) {
+        if (auto reset = std::get_if<EmuEvent::Reset>(&event.type)) {
+            if (MovieOpen()) {
+                Errorf("Can't reset while recording or playing a movie\n");
+            } else {
+                Reset();
+            }
+        } else if (auto openRomFile = std::get_if<EmuEvent::OpenRomFile>(&event.type)) {
+            if (MovieOpen()) {
+                Errorf("Can't open a rom while recording or playing a movie\n");
+                continue;
+            }
+
+            fs::path romPath{};
+            if (openRomFile->path.empty()) {
+                fs::path lastOpenedFile = options.Get<std::string>("lastOpenedFile");
+
+                auto result =
+                    Platform::OpenFileDialog("Open Vectrex rom", "Vectrex Rom", "*.vec;*.bin",
+                                             lastOpenedFile.empty() ? "roms" : lastOpenedFile);
+
+                if (result)
+                    romPath = *result;
+            } else {
+                romPath = openRomFile->path;
+            }
+
+            if (!romPath.empty() && LoadRom(romPath.string().c_str())) {
+                options.Set("lastOpenedFile", romPath.string());
+                options.Save();
+                Reset();
+            }
+        } else if (auto saveState = std::get_if<EmuEvent::SaveState>(&event.type)) {
+            SaveStateFile(saveState->path.empty() ? QuickSaveStateFile : saveState->path);
+        } else if (auto loadState = std::get_if<EmuEvent::LoadState>(&event.type)) {
+            // The other instance wouldn't load it, and the two would no longer be in sync
+            if (!m_syncProtocol.IsStandalone()) {
+                Errorf("Can't load save-states while syncing with another instance\n");
+            } else if (MovieOpen()) {
+                Errorf("Can't load save-states while recording or playing a movie\n");
+            } else {
+                LoadStateFile(loadState->path.empty() ? QuickSaveStateFile : loadState->path);
+            }
+        } else if (auto rewind = std::get_if<EmuEvent::Rewind>(&event.type)) {
+            if (RewindAvailable())
+                rewound = Rewind(rewind->frames);
+        }
+    }
+
+    // Emulate the rewound-to frame for display, but without its audio
+    const size_t numSamples = audioContext.samples.size();
+    if (rewound)
+        frameTime = RewindFrameTime;
+
+    bool keepGoing = m_debugger.FrameUpdate(frameTime, input, emuEvents, renderContext,
+                                            audioContext, m_syncProtocol);
+
+    m_via.FrameUpdate(frameTime);
+
+    if (rewound)
+        audioContext.samples.resize(numSamples);
+
+    if (frameTime > 0 && RewindAvailable()) {
+        SaveState(m_rewindState);
+        m_rewindBuffer.Push(m_rewindState);
+    }
+
+    if (m_syncProtocol.IsServer()) {
+        m_syncProtocol.Server_RecvFrameEnd();
+    } else if (m_syncProtocol.IsClient()) {
+        m_syncProtocol.Client_SendFrameEnd();
+    }
+
+    return keepGoing;
+}
+
+void Vectrexy::Shutdown() {
+    if (m_inputMovie.IsRecording()) {
+        Printf("Recorded movie of %llu frames\n", (unsigned long long)m_inputMovie.NumFrames());
+    }
+    m_inputMovie.Close();
+
+    m_debugger.StopTraceFile();
+
+    if (auto profile = m_cpu.Profile(); profile && !m_profileOpsFile.empty()) {
+        profile->Print(20);
+        if (!profile->WriteCsv(m_profileOpsFile.c_str()))
+            Errorf("Failed to write op profile: %s\n", m_profileOpsFile.c_str());
+    }
+
+    if (auto profile = m_debugger.HotSpotProfile(); profile && !m_profileHotSpotsFile.empty()) {
+        profile->Print(20);
+        if (!profile->WriteFoldedStacks(m_profileHotSpotsFile.c_str()))
+            Errorf("Failed to write hot-spot profile: %s\n", m_profileHotSpotsFile.c_str());
+    }
+}
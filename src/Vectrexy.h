@@ -0,0 +1,78 @@
+#pragma once
+
+#include "BiosRom.h"
+#include "Cartridge.h"
+#include "Cpu.h"
+#include "Debugger.h"
+#include "EngineClient.h"
+#include "IllegalMemoryDevice.h"
+#include "InputMovie.h"
+#include "MemoryBus.h"
+#include "Overlays.h"
+#include "Ram.h"
+#include "RewindBuffer.h"
+#include "SyncProtocol.h"
+#include "Via.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+class Serializer;
+
+// The emulator proper, exposed to engines (SDLEngine, HeadlessEngine) as an IEngineClient
+class Vectrexy final : public IEngineClient {
+private:
+    void SetRewindEnabled(bool enabled) override { m_rewindEnabled = enabled; }
+    void SetRomRequired(bool required) override { m_romRequired = required; }
+    bool Init(int argc, char** argv) override;
+    bool FrameUpdate(double frameTime, const Input& inputArg, const EmuContext& emuContext,
+                     RenderContext& renderContext, AudioContext& audioContext) override;
+    void Shutdown() override;
+
+    void Reset();
+    bool LoadRom(const char* file);
+    void LoadOverlay(const char* file);
+
+    // Save-states hold the state of the whole machine, but not the cartridge rom itself, so must be
+    // loaded with the same rom that was running when saved. Loading fails, leaving the current
+    // state untouched, if the data is not a save-state of the current version.
+    std::vector<uint8_t> SaveState();
+    void SaveState(std::vector<uint8_t>& state); // Reuses state's storage
+    bool LoadState(const std::vector<uint8_t>& state);
+    bool SaveStateFile(const fs::path& path);
+    bool LoadStateFile(const fs::path& path);
+    void SerializeState(Serializer& s);
+
+    // Loads the state numFrames frames back, or the oldest one if there aren't enough
+    bool Rewind(int numFrames);
+
+    // Movies only hold frame time and input, so events that change state any other way (reset,
+    // loading a rom or state, rewinding) are refused while one is open, or playback would diverge
+    bool MovieOpen() const { return m_inputMovie.IsRecording() || m_inputMovie.IsPlaying(); }
+
+    // Rewind needs the engine to enable it, and can't be used while in sync with another instance,
+    // as it isn't sent through the SyncProtocol, or while a movie is open
+    bool RewindAvailable() const {
+        return m_rewindEnabled && m_syncProtocol.IsStandalone() && !MovieOpen();
+    }
+
+    MemoryBus m_memoryBus;
+    Cpu m_cpu;
+    Via m_via;
+    Ram m_ram;
+    BiosRom m_biosRom;
+    IllegalMemoryDevice m_illegal;
+    Cartridge m_cartridge;
+    Debugger m_debugger;
+    Overlays m_overlays;
+    SyncProtocol m_syncProtocol;
+    std::optional<unsigned int> m_ramSeed; // Random if not set
+    bool m_randomizeRam = true;            // On reset
+    bool m_rewindEnabled = false;
+    bool m_romRequired = false;
+    RewindBuffer m_rewindBuffer;
+    std::vector<uint8_t> m_rewindState; // Kept across frames to avoid reallocating it
+    InputMovie m_inputMovie;
+    std::string m_profileOpsFile; // Written on shutdown if set
+    std::string m_profileHotSpotsFile; // Folded stacks, written on shutdown if set
+};
@@ -2,6 +2,9 @@
 #include "BitOps.h"
 #include "EngineClient.h"
 #include "MemoryMap.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
 
 namespace {
     enum class ShiftRegisterMode {
@@ -137,6 +140,7 @@ void Via::Reset() {
     m_interruptEnable = 0;
 
     m_screen = Screen{};
+    m_screen.Init();
     m_psg.Reset();
     m_timer1 = Timer1{};
     m_timer2 = Timer2{};
@@ -147,6 +151,7 @@ void Via::Reset() {
     m_firqEnabled = {};
     m_elapsedAudioCycles = {};
     m_directAudioSamples.Reset();
+    m_psgBandLimitedBuffer.Reset();
 
     SetBits(m_portB, PortB::RampDisabled, true);
 }
@@ -173,17 +178,34 @@ void Via::Update(cycles_t cycles, const Input& input, RenderContext& renderConte
 
     m_firqEnabled = input.IsButtonDown(0, 3);
 
-    // Audio update
-    for (cycles_t i = 0; i < cycles; ++i) {
-        m_psg.Update(1);
-        m_psgAudioSamples.Add(m_psg.Sample());
+    // Audio update, in spans of cycles up to the next audio sample
+    cycles_t audioCyclesLeft = cycles;
+    while (audioCyclesLeft > 0) {
+        const auto cyclesUntilSample = static_cast<cycles_t>(
+            std::max(1.f, std::ceil(audioContext.CpuCyclesPerAudioSample - m_elapsedAudioCycles)));
+        const cycles_t span = std::min(audioCyclesLeft, cyclesUntilSample);
+        audioCyclesLeft -= span;
+
+        if (m_psgPerCycleSampling) {
+            for (cycles_t i = 0; i < span; ++i) {
+                m_psg.Update(1);
+                m_psgAudioSamples.Add(m_psg.Sample());
+            }
+        } else if (m_psgBandLimited) {
+            m_psg.Render(span, m_elapsedAudioCycles / audioContext.CpuCyclesPerAudioSample,
+                         1.f / audioContext.CpuCyclesPerAudioSample, m_psgBandLimitedBuffer);
+        } else {
+            m_psg.Render(span, m_psgAudioSamples);
+        }
 
-        if (++m_elapsedAudioCycles >= audioContext.CpuCyclesPerAudioSample) {
+        m_elapsedAudioCycles += span;
+        if (m_elapsedAudioCycles >= audioContext.CpuCyclesPerAudioSample) {
             m_elapsedAudioCycles -= audioContext.CpuCyclesPerAudioSample;
 
             // Need a target sample...
 
-            float psgSample = m_psgAudioSamples.AverageAndReset();
+            float psgSample = m_psgBandLimited ? m_psgBandLimitedBuffer.ReadSample()
+                                               : m_psgAudioSamples.AverageAndReset();
             float directSample = m_directAudioSamples.AverageAndReset();
 
             //@TODO: Is this right? Averaging means getting half the volume when only one source is
@@ -195,15 +217,17 @@ void Via::Update(cycles_t cycles, const Input& input, RenderContext& renderConte
         }
     }
 
-    //@TODO: Move this code into a Clock() function and call it cycles number of times
-    // For cycle-accurate drawing, we update our timers, shift register, and beam movement 1 cycle
-    // at a time
+    // For cycle-accurate drawing, we update our timers, shift register, and beam movement in spans
+    // during which none of the signals between them change (1 cycle at a time when per-cycle
+    // stepping).
     cycles_t cyclesLeft = cycles;
-    cycles = 1;
-    while (cyclesLeft-- > 0) {
-        m_timer1.Update(cycles);
-        m_timer2.Update(cycles);
-        m_shiftRegister.Update(cycles);
+    while (cyclesLeft > 0) {
+        const cycles_t span = m_perCycleStepping ? 1 : std::min(cyclesLeft, MaxSpanCycles());
+        cyclesLeft -= span;
+
+        m_timer1.Update(span);
+        m_timer2.Update(span);
+        m_shiftRegister.Update(span);
 
         // Shift register's CB2 line drives /BLANK
         //@TODO: check some flag on the shift register to know whether it's active
@@ -216,18 +240,49 @@ void Via::Update(cycles_t cycles, const Input& input, RenderContext& renderConte
             SetBits(m_portB, PortB::RampDisabled, !m_timer1.PB7SignalLow());
         }
 
-        if (PeriphCntl::IsZeroEnabled(m_periphCntl)) {
-            m_screen.ZeroBeam();
-        }
+        m_screen.SetZeroEnabled(PeriphCntl::IsZeroEnabled(m_periphCntl));
 
         // Integrators are enabled while RAMP line is active (low)
         m_screen.SetIntegratorsEnabled(!TestBits(m_portB, PortB::RampDisabled));
 
         // Update screen, which populates the lines in the renderContext
-        m_screen.Update(cycles, renderContext);
+        m_screen.Update(span, renderContext);
     }
 }
 
+// Returns the number of cycles that can be stepped at once in Update with the same result as
+// stepping them one at a time; that is, the signals that Update feeds the screen from the timers
+// and shift register must be the same after the first cycle as after the last. Spans are also kept
+// within the range of the 16-bit timer counters.
+cycles_t Via::MaxSpanCycles() const {
+    const cycles_t MaxTimerCycles = std::numeric_limits<uint16_t>::max();
+
+    // Shift register output drives /BLANK, and changes every other cycle while shifting
+    if (m_shiftRegister.Shifting())
+        return 1;
+
+    // Timer 1 expiring drives /RAMP through PB7. The cycle on which the counter goes from 1 to 0
+    // is the one that expires.
+    if (m_timer1.PB7Flag() && m_timer1.PB7SignalLow() && m_timer1.Counter() > 1)
+        return m_timer1.Counter() - 1u;
+
+    return MaxTimerCycles;
+}
+
+void Via::Serialize(Serializer& s) {
+    s.Serialize(m_portB, m_portA, m_dataDirB, m_dataDirA, m_periphCntl, m_interruptEnable);
+    m_screen.Serialize(s);
+    m_psg.Serialize(s);
+    m_timer1.Serialize(s);
+    m_timer2.Serialize(s);
+    m_shiftRegister.Serialize(s);
+    s.Serialize(m_joystickButtonState, m_joystickPot, m_ca1Enabled, m_ca1InterruptFlag,
+                m_firqEnabled, m_elapsedAudioCycles);
+    m_directAudioSamples.Serialize(s);
+    m_psgAudioSamples.Serialize(s);
+    m_psgBandLimitedBuffer.Serialize(s);
+}
+
 void Via::FrameUpdate(double frameTime) {
     m_screen.FrameUpdate(frameTime);
     m_psg.FrameUpdate(frameTime);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "BandLimitedBuffer.h"
 #include "Line.h"
 #include "MathUtil.h"
 #include "MemoryBus.h"
@@ -25,13 +26,30 @@ public:
                 AudioContext& audioContext);
     void FrameUpdate(double frameTime);
 
+    // By default, Update advances the timers, shift register and screen by spans of cycles over
+    // which stepping one cycle at a time would give the same result. Per-cycle stepping is kept as
+    // the reference to compare against.
+    void SetPerCycleStepping(bool enabled) { m_perCycleStepping = enabled; }
+
+    // By default, the PSG renders each audio sample's worth of cycles at once, only clocking its
+    // generators on the cycles where their output changes. Per-cycle sampling is kept as the
+    // reference to compare against.
+    void SetPsgPerCycleSampling(bool enabled) { m_psgPerCycleSampling = enabled; }
+
+    // Band-limited synthesis resamples the PSG's square waves to the host rate without aliasing,
+    // instead of averaging its output over each audio sample.
+    void SetPsgBandLimited(bool enabled) { m_psgBandLimited = enabled; }
+
     bool IrqEnabled() const;
     bool FirqEnabled() const;
 
+    void Serialize(Serializer& s);
+
 private:
     uint8_t Read(uint16_t address) const override;
     void Write(uint16_t address, uint8_t value) override;
     uint8_t GetInterruptFlagValue() const;
+    cycles_t MaxSpanCycles() const;
 
     // Registers
     uint8_t m_portB;
@@ -54,4 +72,8 @@ private:
     float m_elapsedAudioCycles{};
     MathUtil::AverageValue m_directAudioSamples;
     MathUtil::AverageValue m_psgAudioSamples;
+    BandLimitedBuffer m_psgBandLimitedBuffer;
+    bool m_perCycleStepping = false;
+    bool m_psgPerCycleSampling = false;
+    bool m_psgBandLimited = false;
 };
@@ -0,0 +1,674 @@
+// Benchmark suite of fixed, deterministic workloads, run against the emulator components in
+// isolation (MemoryBus, Cpu, Via, Screen, Psg) and together (the BIOS booting into Mine Storm).
+// Results are printed as one JSON object per line, so they can be collected and compared across
+// commits. The checksum changes whenever a workload's output does (registers, lines, samples).
+//
+// Run from the directory containing bios_rom.bin (or any of its subdirs). Pass workload names or
+// name prefixes (e.g. "cpu_" or "system_boot") to only run those.
+
+#include "BandLimitedBuffer.h"
+#include "BiosRom.h"
+#include "Cartridge.h"
+#include "ConsoleOutput.h"
+#include "Cpu.h"
+#include "EngineClient.h"
+#include "FileSystemUtil.h"
+#include "IllegalMemoryDevice.h"
+#include "InstructionHasher.h"
+#include "InstructionTrace.h"
+#include "MathUtil.h"
+#include "MemoryBus.h"
+#include "MemoryMap.h"
+#include "Psg.h"
+#include "Ram.h"
+#include "Screen.h"
+#include "Serializer.h"
+#include "Stream.h"
+#include "Via.h"
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+namespace {
+    const double CpuCyclesPerSec = 1'500'000;
+    const double CyclesPerFrame = CpuCyclesPerSec / 60;
+    const float CpuCyclesPerAudioSample = static_cast<float>(CpuCyclesPerSec / 44100);
+    const unsigned int RamSeed = 0x12345678;
+
+    const size_t NumReads = 100'000'000;
+    const uint64_t NumCpuInstructions = 50'000'000;
+    const int NumVectors = 100'000;
+    const cycles_t NumPsgCycles = 15'000'000;
+    const int NumBootFrames = 620; // Frames until Mine Storm starts
+    const int NumMineStormFrames = 600;
+    const int NumSaveStates = 100'000;
+    const size_t NumTracedInstructions = 64 * 1024;
+    const int NumTraceHashPasses = 200;
+    const size_t InstructionsPerFrame = 10'000;
+
+    // Deterministic number generator, so that runs are comparable
+    struct XorShift32 {
+        uint32_t state = 0x12345678;
+        uint32_t operator()() {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return state;
+        }
+    };
+
+    // Running CRC32C of a workload's output
+    struct Checksum {
+        uint32_t value = 0;
+
+        void Add(const void* data, size_t size) { value = Crc32c(value, data, size); }
+
+        template <typename T>
+        void Add(const std::vector<T>& values) {
+            Add(values.data(), values.size() * sizeof(T));
+        }
+
+        void Add(const CpuRegisters& regs) {
+            for (uint16_t value : {regs.X, regs.Y, regs.U, regs.S, regs.PC, regs.D})
+                Add(&value, sizeof(value));
+            for (uint8_t value : {regs.DP, regs.CC.Value})
+                Add(&value, sizeof(value));
+        }
+    };
+
+    struct Result {
+        double seconds{};
+        uint64_t reads{};
+        uint64_t instructions{};
+        uint64_t cycles{};
+        uint64_t lines{};
+        uint64_t samples{};
+        uint64_t states{}; // Save-states saved then loaded back
+        size_t stateBytes{};
+        int frames{}; // If not set, derived from cycles
+        Checksum checksum;
+    };
+
+    void PrintResult(const char* workload, const Result& r) {
+        Printf("{\"workload\": \"%s\", \"seconds\": %.4f", workload, r.seconds);
+        if (r.reads > 0) {
+            Printf(", \"reads\": %llu, \"reads_per_sec\": %.0f", (unsigned long long)r.reads,
+                   r.reads / r.seconds);
+        }
+        if (r.instructions > 0) {
+            Printf(", \"instructions\": %llu, \"instructions_per_sec\": %.0f",
+                   (unsigned long long)r.instructions, r.instructions / r.seconds);
+        }
+        if (r.cycles > 0) {
+            Printf(", \"cycles\": %llu, \"cycles_per_sec\": %.0f", (unsigned long long)r.cycles,
+                   r.cycles / r.seconds);
+        }
+        if (r.lines > 0 || r.samples > 0) {
+            const double frames = r.frames > 0 ? r.frames : r.cycles / CyclesPerFrame;
+            Printf(", \"frames\": %.1f, \"lines_per_frame\": %.2f, \"samples_per_frame\": %.2f",
+                   frames, r.lines / frames, r.samples / frames);
+        }
+        if (r.states > 0) {
+            Printf(", \"states\": %llu, \"state_bytes\": %zu, \"usec_per_save_load\": %.3f",
+                   (unsigned long long)r.states, r.stateBytes, r.seconds * 1e6 / r.states);
+        }
+        Printf(", \"checksum\": \"%08x\"}\n", r.checksum.value);
+    }
+
+    template <typename Func>
+    double TimeSeconds(Func func) {
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        func();
+        const std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - startTime;
+        return elapsed.count();
+    }
+
+    // Collects lines and audio samples produced by the Via, like an engine would every frame
+    struct Output {
+        Input input;
+        RenderContext renderContext;
+        AudioContext audioContext{CpuCyclesPerAudioSample};
+
+        void Flush(Result& result) {
+            result.lines += renderContext.lines.size();
+            result.samples += audioContext.samples.size();
+            result.checksum.Add(renderContext.lines);
+            result.checksum.Add(audioContext.samples);
+            renderContext.lines.clear();
+            audioContext.samples.clear();
+        }
+    };
+
+    // The whole system, connected as Vectrexy does, without the debugger
+    struct System {
+        MemoryBus memoryBus;
+        Cpu cpu;
+        Via via;
+        Ram ram;
+        BiosRom biosRom;
+        IllegalMemoryDevice illegal;
+        Cartridge cartridge;
+
+        System() {
+            cpu.Init(memoryBus);
+            via.Init(memoryBus);
+            ram.Init(memoryBus);
+            biosRom.Init(memoryBus);
+            illegal.Init(memoryBus);
+            cartridge.Init(memoryBus);
+            biosRom.LoadBiosRom("bios_rom.bin");
+
+            cpu.Reset();
+            via.Reset();
+            ram.Reset();
+            ram.Randomize(RamSeed);
+        }
+
+        // Same as the debugger's instruction-by-instruction frame update
+        void ExecuteFrame(double& cyclesLeft, Output& output, Result& result) {
+            cyclesLeft += CyclesPerFrame;
+            while (cyclesLeft > 0) {
+                const cycles_t cpuCycles =
+                    cpu.ExecuteInstruction(via.IrqEnabled(), via.FirqEnabled());
+                if (cpuCycles > 0)
+                    ++result.instructions;
+
+                const cycles_t effectiveCycles = cpuCycles == 0 ? 10 : cpuCycles;
+                via.Update(effectiveCycles, output.input, output.renderContext,
+                           output.audioContext);
+                cyclesLeft -= effectiveCycles;
+                result.cycles += effectiveCycles;
+            }
+        }
+
+        // Same components as a Vectrexy save-state, minus the header and debugger cycle counts
+        void Serialize(Serializer& s) {
+            cpu.Serialize(s);
+            via.Serialize(s);
+            ram.Serialize(s);
+        }
+    };
+
+    Result RunMemoryBusWorkload(const std::function<uint16_t(size_t)>& addressGenerator) {
+        System system;
+
+        // Pre-generate addresses so that we only time the bus reads
+        std::vector<uint16_t> addresses(1024 * 1024);
+        for (size_t i = 0; i < addresses.size(); ++i)
+            addresses[i] = addressGenerator(i);
+
+        Result result;
+        uint32_t sum = 0;
+        result.seconds = TimeSeconds([&] {
+            for (size_t i = 0; i < NumReads; ++i) {
+                sum += system.memoryBus.Read(addresses[i & (addresses.size() - 1)]);
+            }
+        });
+        result.reads = NumReads;
+        result.checksum.Add(&sum, sizeof(sum));
+        return result;
+    }
+
+    uint16_t FirstAddress(const MemoryMap::Mapping& mapping) { return mapping.range.first; }
+
+    // Maps a program over the cartridge range, and points the reset vector at it
+    class ProgramRom : public IMemoryBusDevice {
+    public:
+        ProgramRom(MemoryBus& memoryBus, std::vector<uint8_t> program)
+            : m_program(std::move(program)) {
+            memoryBus.ConnectDevice(*this, MemoryMap::Cartridge.range);
+            memoryBus.ConnectDevice(*this, MemoryMap::Bios.range);
+        }
+
+    private:
+        uint8_t Read(uint16_t address) const override {
+            if (address < m_program.size())
+                return m_program[address];
+            return 0; // Including reset vector at $fffe
+        }
+        void Write(uint16_t /*address*/, uint8_t /*value*/) override {}
+
+        std::vector<uint8_t> m_program;
+    };
+
+    // Program that loops over the instructions in body, operating on RAM: DP is $c8, and X and Y
+    // point into RAM at $c880 and $c8a0
+    std::vector<uint8_t> MakeCpuProgram(std::initializer_list<uint8_t> body) {
+        std::vector<uint8_t> program = {
+            0x10, 0xCE, 0xCB, 0xE0, // LDS #$cbe0
+            0x86, 0xC8,             // LDA #$c8
+            0x1F, 0x8B,             // TFR A,DP
+            0x8E, 0xC8, 0x80,       // LDX #$c880
+            0x10, 0x8E, 0xC8, 0xA0, // LDY #$c8a0
+        };
+        const auto loopStart = static_cast<uint16_t>(program.size());
+        for (int i = 0; i < 4; ++i)
+            program.insert(program.end(), body);
+        program.insert(program.end(), {0x7E, static_cast<uint8_t>(loopStart >> 8),
+                                       static_cast<uint8_t>(loopStart & 0xFF)}); // JMP loopStart
+        return program;
+    }
+
+    Result RunCpuWorkload(std::initializer_list<uint8_t> body) {
+        MemoryBus memoryBus;
+        Cpu cpu;
+        Ram ram;
+        ProgramRom programRom(memoryBus, MakeCpuProgram(body));
+        cpu.Init(memoryBus);
+        ram.Init(memoryBus);
+        ram.Randomize(RamSeed);
+        cpu.Reset();
+
+        Result result;
+        result.seconds = TimeSeconds([&] {
+            for (uint64_t i = 0; i < NumCpuInstructions; ++i) {
+                result.cycles += cpu.ExecuteInstruction(false, false);
+            }
+        });
+        result.instructions = NumCpuInstructions;
+        result.checksum.Add(cpu.Registers());
+        return result;
+    }
+
+    // Draws vectors the way the BIOS does, with a random delta, and zeroes the beam every 16
+    // vectors. Via is updated every 4 cycles, about as often as the CPU would.
+    Result RunViaWorkload() {
+        MemoryBus memoryBus;
+        Via via;
+        via.Init(memoryBus);
+        via.Reset();
+
+        Output output;
+        Result result;
+        auto write = [&](uint8_t reg, uint8_t value) {
+            memoryBus.Write(FirstAddress(MemoryMap::Via) + reg, value);
+        };
+        auto update = [&](int cycles) {
+            for (; cycles > 0; cycles -= 4) {
+                via.Update(4, output.input, output.renderContext, output.audioContext);
+                result.cycles += 4;
+            }
+        };
+
+        XorShift32 rng;
+        result.seconds = TimeSeconds([&] {
+            write(0x3, 0xFF); // DataDirA
+            write(0x2, 0x9F); // DataDirB
+            write(0xB, 0x98); // AuxCntl: Timer1 drives PB7 (/RAMP), shift out under phi2
+            write(0xC, 0xCE); // PeriphCntl: /ZERO high
+            write(0x1, 0x5F); // PortA: brightness
+            write(0x0, 0x04); // PortB: mux Z axis
+            write(0x0, 0x05); // PortB: mux disabled
+
+            for (int i = 0; i < NumVectors; ++i) {
+                const uint32_t value = rng();
+                write(0x1, static_cast<uint8_t>(value));      // PortA: dy
+                write(0x0, 0x00);                             // PortB: mux Y integrator
+                write(0x0, 0x01);                             // PortB: mux disabled
+                write(0x1, static_cast<uint8_t>(value >> 8)); // PortA: dx
+                write(0x4, 0x7F);                             // Timer1Low: scale
+                write(0xA, 0xFF);                             // Shift: beam on
+                write(0x5, 0x00);                             // Timer1High: start ramp
+                update(0x7F + 8);
+                write(0xA, 0x00); // Shift: beam off
+                update(20);
+
+                if (i % 16 == 15) {
+                    write(0xC, 0xCC); // PeriphCntl: /ZERO low
+                    update(40);
+                    write(0xC, 0xCE);
+                }
+
+                if (output.renderContext.lines.size() > 10'000)
+                    output.Flush(result);
+            }
+            output.Flush(result);
+        });
+        return result;
+    }
+
+    // Same pattern as RunViaWorkload, feeding the Screen directly
+    Result RunScreenWorkload() {
+        Screen screen;
+        screen.Init();
+
+        Output output;
+        Result result;
+        auto update = [&](int cycles) {
+            for (; cycles > 0; cycles -= 4) {
+                screen.Update(4, output.renderContext);
+                result.cycles += 4;
+            }
+        };
+
+        XorShift32 rng;
+        result.seconds = TimeSeconds([&] {
+            screen.SetBrightness(0x5F);
+            for (int i = 0; i < NumVectors; ++i) {
+                const uint32_t value = rng();
+                screen.SetIntegratorY(static_cast<int8_t>(value));
+                screen.SetIntegratorX(static_cast<int8_t>(value >> 8));
+                screen.SetBlankEnabled(false);
+                screen.SetIntegratorsEnabled(true);
+                update(0x7F + 8);
+                screen.SetIntegratorsEnabled(false);
+                screen.SetBlankEnabled(true);
+                update(20);
+
+                if (i % 16 == 15) {
+                    screen.SetZeroEnabled(true);
+                    update(40);
+                    screen.SetZeroEnabled(false);
+                }
+
+                if (output.renderContext.lines.size() > 10'000)
+                    output.Flush(result);
+            }
+            output.Flush(result);
+        });
+        return result;
+    }
+
+    void WritePsgRegister(Psg& psg, uint8_t reg, uint8_t value) {
+        // Latch address, then write, going back to inactive mode after each
+        psg.WriteDA(reg);
+        psg.SetBDIR(true);
+        psg.SetBC1(true);
+        psg.Update(1);
+        psg.SetBDIR(false);
+        psg.SetBC1(false);
+        psg.Update(1);
+        psg.WriteDA(value);
+        psg.SetBDIR(true);
+        psg.Update(1);
+        psg.SetBDIR(false);
+        psg.Update(1);
+    }
+
+    enum class PsgOutput { PerCycle, Averaged, BandLimited };
+
+    // Three tones, noise and an envelope, either clocked and sampled every cycle, or rendered an
+    // audio sample's worth of cycles at a time like the Via does
+    Result RunPsgWorkload(PsgOutput psgOutput) {
+        Psg psg;
+        psg.Init();
+        psg.Reset();
+
+        const std::pair<uint8_t, uint8_t> registers[] = {
+            {0, 0x00}, {1, 0x01},  // Tone A period
+            {2, 0xC0}, {3, 0x00},  // Tone B period
+            {4, 0x50}, {5, 0x00},  // Tone C period
+            {6, 0x10},             // Noise period
+            {7, 0x30},             // Mixer: tones on all channels, noise on A
+            {8, 0x0F}, {9, 0x0C},  // Fixed amplitudes A and B
+            {10, 0x10},            // Envelope amplitude C
+            {11, 0x00}, {12, 0x08}, // Envelope period
+            {13, 0x0E},            // Envelope shape
+        };
+        for (auto& [reg, value] : registers)
+            WritePsgRegister(psg, reg, value);
+
+        Result result;
+        float sum = 0.f;
+        result.seconds = TimeSeconds([&] {
+            const auto cyclesPerSample = static_cast<cycles_t>(CpuCyclesPerAudioSample);
+            if (psgOutput == PsgOutput::Averaged) {
+                MathUtil::AverageValue samples;
+                for (cycles_t i = 0; i < NumPsgCycles; i += cyclesPerSample) {
+                    psg.Render(std::min(cyclesPerSample, NumPsgCycles - i), samples);
+                    sum += samples.Sum();
+                    samples.Reset();
+                }
+                return;
+            }
+            if (psgOutput == PsgOutput::BandLimited) {
+                BandLimitedBuffer buffer;
+                for (cycles_t i = 0; i < NumPsgCycles; i += cyclesPerSample) {
+                    psg.Render(std::min(cyclesPerSample, NumPsgCycles - i), 0.f,
+                               1.f / cyclesPerSample, buffer);
+                    sum += buffer.ReadSample();
+                }
+                return;
+            }
+            for (cycles_t i = 0; i < NumPsgCycles; ++i) {
+                psg.Update(1);
+                sum += psg.Sample();
+            }
+        });
+        result.cycles = NumPsgCycles;
+        result.checksum.Add(&sum, sizeof(sum));
+        return result;
+    }
+
+    Result RunSystemWorkload(int numFramesToSkip, int numFrames) {
+        System system;
+        Output output;
+        double cyclesLeft = 0;
+
+        Result skipped;
+        for (int i = 0; i < numFramesToSkip; ++i) {
+            system.ExecuteFrame(cyclesLeft, output, skipped);
+            output.Flush(skipped);
+        }
+
+        Result result;
+        result.seconds = TimeSeconds([&] {
+            for (int i = 0; i < numFrames; ++i) {
+                system.ExecuteFrame(cyclesLeft, output, result);
+                output.Flush(result);
+            }
+        });
+        result.frames = numFrames;
+        result.checksum.Add(system.cpu.Registers());
+        return result;
+    }
+
+    // Saves and loads back the state of the system once it's running Mine Storm
+    Result RunSaveStateWorkload() {
+        System system;
+        Output output;
+        double cyclesLeft = 0;
+
+        Result skipped;
+        for (int i = 0; i < NumBootFrames; ++i) {
+            system.ExecuteFrame(cyclesLeft, output, skipped);
+            output.Flush(skipped);
+        }
+
+        ByteCounterStream counter;
+        Serializer counterSerializer(counter, Serializer::Mode::Save);
+        system.Serialize(counterSerializer);
+
+        Result result;
+        std::vector<uint8_t> state(counter.GetStreamSize());
+        result.seconds = TimeSeconds([&] {
+            for (int i = 0; i < NumSaveStates; ++i) {
+                for (auto mode : {Serializer::Mode::Save, Serializer::Mode::Load}) {
+                    MemoryStream stream;
+                    stream.Open(state.data(), state.size());
+                    Serializer serializer(stream, mode);
+                    system.Serialize(serializer);
+                }
+            }
+        });
+        result.states = NumSaveStates;
+        result.stateBytes = state.size();
+        result.checksum.Add(state);
+        return result;
+    }
+
+    // Instructions with random registers and memory accesses, as captured by the debugger's trace
+    std::vector<InstructionTraceInfo> MakeTracedInstructions() {
+        const uint8_t opCodes[] = {0x86, 0x97, 0xA6, 0xB7, 0xEC, 0x8D, 0x4C, 0x34, 0x39, 0x27};
+        XorShift32 rng;
+        std::vector<InstructionTraceInfo> traceInfos(NumTracedInstructions);
+        CpuRegisters regs{};
+        for (auto& traceInfo : traceInfos) {
+            traceInfo.instruction.cpuOp = &LookupCpuOp(0, opCodes[rng() % std::size(opCodes)]);
+            traceInfo.preOpCpuRegisters = regs;
+            regs.X = static_cast<uint16_t>(rng());
+            regs.D = static_cast<uint16_t>(rng());
+            regs.PC = static_cast<uint16_t>(regs.PC + 1 + rng() % 3);
+            regs.CC.Value = static_cast<uint8_t>(rng());
+            traceInfo.postOpCpuRegisters = regs;
+            traceInfo.elapsedCycles = 2 + rng() % 6;
+            for (uint32_t i = rng() % 4; i > 0; --i) {
+                traceInfo.AddMemoryAccess(static_cast<uint16_t>(rng()),
+                                          static_cast<uint8_t>(rng()), rng() % 2 == 0);
+            }
+        }
+        return traceInfos;
+    }
+
+    // Hashes traced instructions as sync mode does, in frames of InstructionsPerFrame
+    Result RunTraceHashWorkload(InstructionHasher::Mode mode, size_t granularity) {
+        const auto traceInfos = MakeTracedInstructions();
+        InstructionHasher hasher;
+        hasher.Init(mode, granularity);
+
+        Result result;
+        result.seconds = TimeSeconds([&] {
+            for (int pass = 0; pass < NumTraceHashPasses; ++pass) {
+                for (auto& traceInfo : traceInfos) {
+                    hasher.Add(traceInfo);
+                    if (hasher.InstructionsInFrame() == InstructionsPerFrame) {
+                        hasher.EndFrame();
+                        hasher.BeginFrame();
+                    }
+                }
+            }
+            hasher.EndFrame();
+        });
+        result.instructions = NumTracedInstructions * NumTraceHashPasses;
+        const uint32_t hash = hasher.Hash();
+        result.checksum.Add(&hash, sizeof(hash));
+        return result;
+    }
+
+    struct Workload {
+        const char* name;
+        std::function<Result()> run;
+    };
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (!fs::exists("bios_rom.bin") &&
+        !FileSystemUtil::FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
+        return -1;
+
+    // Reads over the whole address space skip the Via and illegal ranges that aren't plain memory
+    XorShift32 rng;
+    auto randomAddress = [&rng](size_t) {
+        auto address = static_cast<uint16_t>(rng());
+        if (MemoryMap::IsInRange(address, MemoryMap::Via.range) ||
+            MemoryMap::IsInRange(address, MemoryMap::Illegal.range)) {
+            address |= MemoryMap::Bios.range.first;
+        }
+        return address;
+    };
+    auto sequentialAddress = [](const MemoryMap::Mapping& mapping) {
+        return [&mapping](size_t i) {
+            return static_cast<uint16_t>(FirstAddress(mapping) + i % mapping.physicalSize);
+        };
+    };
+
+    // clang-format off
+    const Workload workloads[] = {
+        {"membus_bios_sequential", [&] { return RunMemoryBusWorkload(sequentialAddress(MemoryMap::Bios)); }},
+        {"membus_cartridge_sequential", [&] { return RunMemoryBusWorkload(sequentialAddress(MemoryMap::Cartridge)); }},
+        {"membus_ram_sequential", [&] { return RunMemoryBusWorkload(sequentialAddress(MemoryMap::Ram)); }},
+        {"membus_random", [&] { return RunMemoryBusWorkload(randomAddress); }},
+
+        // Opcode mixes per AddressingMode
+        {"cpu_inherent", [] { return RunCpuWorkload({
+            0x12,       // NOP
+            0x4C,       // INCA
+            0x5A,       // DECB
+            0x3A,       // ABX
+            0x3D,       // MUL
+            0x1D,       // SEX
+            0x48,       // ASLA
+            0x53,       // COMB
+        }); }},
+        {"cpu_immediate", [] { return RunCpuWorkload({
+            0x86, 0x12,       // LDA #$12
+            0x8B, 0x01,       // ADDA #$01
+            0xC6, 0x34,       // LDB #$34
+            0xC4, 0x0F,       // ANDB #$0f
+            0xCC, 0x12, 0x34, // LDD #$1234
+            0x83, 0x00, 0x01, // SUBD #$0001
+            0x8C, 0xC8, 0x80, // CMPX #$c880
+        }); }},
+        {"cpu_direct", [] { return RunCpuWorkload({
+            0x96, 0x80, // LDA <$80
+            0x97, 0x81, // STA <$81
+            0x9B, 0x82, // ADDA <$82
+            0xDC, 0x84, // LDD <$84
+            0xDD, 0x86, // STD <$86
+            0x0C, 0x88, // INC <$88
+            0x91, 0x89, // CMPA <$89
+        }); }},
+        {"cpu_extended", [] { return RunCpuWorkload({
+            0xB6, 0xC8, 0x80, // LDA $c880
+            0xB7, 0xC8, 0x81, // STA $c881
+            0xBB, 0xC8, 0x82, // ADDA $c882
+            0xFC, 0xC8, 0x84, // LDD $c884
+            0xFD, 0xC8, 0x86, // STD $c886
+            0x7C, 0xC8, 0x88, // INC $c888
+            0xB1, 0xC8, 0x89, // CMPA $c889
+        }); }},
+        {"cpu_indexed", [] { return RunCpuWorkload({
+            0xA6, 0x84,             // LDA ,X
+            0xE6, 0x01,             // LDB 1,X
+            0xA7, 0x22,             // STA 2,Y
+            0xEC, 0x88, 0x10,       // LDD $10,X
+            0xAB, 0x85,             // ADDA B,X
+            0xE7, 0xA4,             // STB ,Y
+            0xED, 0xA9, 0x00, 0x08, // STD $0008,Y
+            0x33, 0x08,             // LEAU 8,X
+        }); }},
+        {"cpu_relative", [] { return RunCpuWorkload({
+            0x4F,                   // CLRA
+            0x27, 0x00,             // BEQ +0 (taken)
+            0x26, 0x00,             // BNE +0 (not taken)
+            0x20, 0x00,             // BRA +0
+            0x16, 0x00, 0x00,       // LBRA +0
+            0x10, 0x26, 0x00, 0x00, // LBNE +0 (not taken)
+            0x8D, 0x02,             // BSR +2
+            0x21, 0x00,             // BRN +0, skipped over by BSR
+            0x32, 0x62,             // LEAS 2,S (pop BSR return address)
+        }); }},
+
+        {"via_draw_vectors", [] { return RunViaWorkload(); }},
+        {"screen_draw_vectors", [] { return RunScreenWorkload(); }},
+        {"psg_tones_noise_envelope", [] { return RunPsgWorkload(PsgOutput::PerCycle); }},
+        {"psg_render_tones_noise_envelope", [] { return RunPsgWorkload(PsgOutput::Averaged); }},
+        {"psg_bandlimited_tones_noise_envelope", [] { return RunPsgWorkload(PsgOutput::BandLimited); }},
+
+        {"system_boot", [] { return RunSystemWorkload(0, NumBootFrames); }},
+        {"system_minestorm", [] { return RunSystemWorkload(NumBootFrames, NumMineStormFrames); }},
+        {"system_savestate", [] { return RunSaveStateWorkload(); }},
+
+        {"trace_hash_legacy", [] { return RunTraceHashWorkload(InstructionHasher::Mode::Legacy, InstructionHasher::FrameGranularity); }},
+        {"trace_hash_fast", [] { return RunTraceHashWorkload(InstructionHasher::Mode::Fast, InstructionHasher::FrameGranularity); }},
+        {"trace_hash_fast_checkpoints", [] { return RunTraceHashWorkload(InstructionHasher::Mode::Fast, 64); }},
+    };
+    // clang-format on
+
+    for (auto& workload : workloads) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i) {
+            if (std::string(workload.name).rfind(argv[i], 0) == 0)
+                selected = true;
+        }
+
+        if (selected)
+            PrintResult(workload.name, workload.run());
+    }
+
+    return 0;
+}
@@ -0,0 +1,422 @@
+#include "HeadlessEngine.h"
+
+#include "AllocationCounter.h"
+#include "ConsoleOutput.h"
+#include "FileSystem.h"
+#include "FileSystemUtil.h"
+#include "FrameHash.h"
+#include "Options.h"
+#include "Stream.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    IEngineClient* g_client = nullptr;
+    IEngineClient* g_referenceClient = nullptr;
+
+    // Emulate at a fixed 60 Hz frame rate, and produce audio samples at a typical host rate
+    const double FrameTime = 1.0 / 60.0;
+    const float CpuCyclesPerSec = 1'500'000;
+    const int AudioSampleRate = 44100;
+
+    struct HeadlessOptions {
+        int numFrames = 60 * 60;
+        std::optional<std::string> linesFile;
+        std::optional<std::string> samplesFile;
+        std::optional<std::string> writeHashesFile;
+        std::optional<std::string> checkHashesFile;
+        bool traceEnabled = false;
+        bool compare = false;
+        float lineTolerance = 0;   // Of line end points, when comparing
+        float sampleTolerance = 0; // Of audio samples, when comparing
+        std::optional<std::string> loadStateFile;
+        std::optional<std::string> saveStateFile;
+        std::vector<std::string> clientArgs;
+        std::vector<std::string> referenceArgs; // Extra args for the reference client
+    };
+
+    // Emulator options followed by a value, and of those, the ones whose value is a path. The root
+    // path gets changed to where the bios is before the emulator resolves them, so paths are made
+    // absolute.
+    const std::array<const char*, 3> ClientValueOptions = {"-seed", "-hashmode",
+                                                           "-hashgranularity"};
+    const std::array<const char*, 5> ClientPathOptions = {
+        "-recordmovie", "-playmovie", "-tracefile", "-profileops", "-profilehotspots"};
+
+    template <typename Container>
+    bool IsOneOf(const std::string& arg, const Container& names) {
+        return std::find(names.begin(), names.end(), arg) != names.end();
+    }
+
+    void PrintUsage(const char* exeName) {
+        Printf("Usage: %s [options] [rom]\n", exeName);
+        Printf("Options:\n");
+        Printf("  -frames <n>          Number of frames to emulate (default: 3600)\n");
+        Printf("  -dumplines <file>    Dump lines of every frame to file\n");
+        Printf("  -dumpsamples <file>  Dump audio samples of every frame to file\n");
+        Printf("  -writehashes <file>  Write a hash of the lines and audio samples of every frame\n"
+               "                       to file\n");
+        Printf("  -checkhashes <file>  Compare the hash of every frame against a file written\n"
+               "                       with -writehashes, and stop at the first mismatch\n");
+        Printf("  -trace               Enable debugger instruction tracing (slower)\n");
+        Printf("  -loadstate <file>    Load save-state before emulating the first frame\n");
+        Printf("  -savestate <file>    Save state after emulating the last frame\n");
+        Printf("  -compare <arg>       Run a reference emulator alongside, with extra argument\n"
+               "                       <arg> (e.g. -viapercycle), and stop at the first frame\n"
+               "                       with different lines or audio samples (repeatable)\n");
+        Printf("  -linetolerance <d>   Let line end points differ by up to d units when comparing\n"
+               "                       (default: 0, bit-exact)\n");
+        Printf("  -sampletolerance <d> Let audio samples differ by up to d when comparing\n"
+               "                       (default: 0, bit-exact)\n");
+        Printf("Any other argument is passed on to the emulator (e.g. rom path, -blocks)\n");
+    }
+
+    std::optional<HeadlessOptions> ParseArgs(int argc, char** argv) {
+        HeadlessOptions options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "-frames" && hasValue) {
+                options.numFrames = std::stoi(argv[++i]);
+            } else if (arg == "-dumplines" && hasValue) {
+                options.linesFile = argv[++i];
+            } else if (arg == "-dumpsamples" && hasValue) {
+                options.samplesFile = argv[++i];
+            } else if (arg == "-writehashes" && hasValue) {
+                options.writeHashesFile = argv[++i];
+            } else if (arg == "-checkhashes" && hasValue) {
+                options.checkHashesFile = argv[++i];
+            } else if (arg == "-trace") {
+                options.traceEnabled = true;
+            } else if (arg == "-loadstate" && hasValue) {
+                options.loadStateFile = fs::absolute(argv[++i]).string();
+            } else if (arg == "-savestate" && hasValue) {
+                options.saveStateFile = fs::absolute(argv[++i]).string();
+            } else if (arg == "-compare" && hasValue) {
+                options.compare = true;
+                options.referenceArgs.push_back(argv[++i]);
+            } else if (arg == "-linetolerance" && hasValue) {
+                options.lineTolerance = std::stof(argv[++i]);
+            } else if (arg == "-sampletolerance" && hasValue) {
+                options.sampleTolerance = std::stof(argv[++i]);
+            } else if (arg == "-h" || arg == "-help") {
+                return {};
+            } else if (IsOneOf(arg, ClientPathOptions) && hasValue) {
+                options.clientArgs.push_back(arg);
+                options.clientArgs.push_back(fs::absolute(argv[++i]).string());
+            } else if (IsOneOf(arg, ClientValueOptions) && hasValue) {
+                options.clientArgs.push_back(arg);
+                options.clientArgs.push_back(argv[++i]);
+            } else if (!arg.empty() && arg[0] != '-') {
+                // The rom
+                options.clientArgs.push_back(fs::absolute(arg).string());
+            } else {
+                options.clientArgs.push_back(arg);
+            }
+        }
+
+        if (!options.traceEnabled)
+            options.clientArgs.push_back("-notrace");
+
+        // Both emulators must start from the same random RAM contents, so pick a seed unless one
+        // was given, and print it so that a mismatch can be reproduced
+        if (options.compare) {
+            // Like the emulator, use the last seed given
+            std::optional<std::string> seed;
+            for (size_t i = 0; i + 1 < options.clientArgs.size(); ++i) {
+                if (options.clientArgs[i] == "-seed")
+                    seed = options.clientArgs[i + 1];
+            }
+            if (!seed) {
+                seed = std::to_string(std::random_device{}());
+                options.clientArgs.push_back("-seed");
+                options.clientArgs.push_back(*seed);
+            }
+            Printf("Comparing with RAM seed %s\n", seed->c_str());
+        }
+
+        return options;
+    }
+
+    // Lines dump format, per frame: uint32_t numLines, followed by numLines Line structs
+    void DumpLines(FileStream& stream, const RenderContext& renderContext) {
+        const auto numLines = static_cast<uint32_t>(renderContext.lines.size());
+        stream.WriteValue(numLines);
+        stream.Write(renderContext.lines.data(), renderContext.lines.size());
+    }
+
+    // Samples dump format: raw 32-bit float mono samples at AudioSampleRate
+    void DumpSamples(FileStream& stream, const AudioContext& audioContext) {
+        stream.Write(audioContext.samples.data(), audioContext.samples.size());
+    }
+
+    // Returns index of first element for which equal() is false, or size of the smallest if one is
+    // a prefix of the other, or nullopt if they're identical
+    template <typename T, typename EqualFunc>
+    std::optional<size_t> FindMismatch(const std::vector<T>& lhs, const std::vector<T>& rhs,
+                                       EqualFunc equal) {
+        const size_t size = std::min(lhs.size(), rhs.size());
+        for (size_t i = 0; i < size; ++i) {
+            if (!equal(lhs[i], rhs[i]))
+                return i;
+        }
+        if (lhs.size() != rhs.size())
+            return size;
+        return {};
+    }
+
+    // Comparisons are exact unless given a tolerance, which is only meant for comparing against
+    // changes that are expected to round differently
+    bool LinesMatch(const Line& lhs, const Line& rhs, float tolerance) {
+        auto Near = [tolerance](const Vector2& a, const Vector2& b) {
+            return std::abs(a.x - b.x) <= tolerance && std::abs(a.y - b.y) <= tolerance;
+        };
+        return Near(lhs.p0, rhs.p0) && Near(lhs.p1, rhs.p1) && lhs.brightness == rhs.brightness;
+    }
+
+    bool SamplesMatch(float lhs, float rhs, float tolerance) {
+        return std::abs(lhs - rhs) <= tolerance;
+    }
+
+    bool CompareFrames(int frame, const RenderContext& renderContext,
+                       const AudioContext& audioContext, const RenderContext& refRenderContext,
+                       const AudioContext& refAudioContext, const HeadlessOptions& options) {
+        auto linesMatch = [&](const Line& lhs, const Line& rhs) {
+            return LinesMatch(lhs, rhs, options.lineTolerance);
+        };
+        auto samplesMatch = [&](float lhs, float rhs) {
+            return SamplesMatch(lhs, rhs, options.sampleTolerance);
+        };
+        if (auto index = FindMismatch(renderContext.lines, refRenderContext.lines, linesMatch)) {
+            Errorf("Frame %d: lines differ at index %zu (%zu lines, reference has %zu)\n", frame,
+                   *index, renderContext.lines.size(), refRenderContext.lines.size());
+            return false;
+        }
+        if (auto index =
+                FindMismatch(audioContext.samples, refAudioContext.samples, samplesMatch)) {
+            Errorf("Frame %d: audio samples differ at index %zu (%zu samples, reference has %zu)\n",
+                   frame, *index, audioContext.samples.size(), refAudioContext.samples.size());
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckFrameHash(int frame, const FrameHash& frameHash,
+                        const std::optional<FrameHash>& goldenHash) {
+        if (!goldenHash) {
+            Errorf("Frame %d: past the last frame of the golden hashes\n", frame);
+            return false;
+        }
+        if (!frameHash.LinesMatch(*goldenHash)) {
+            Errorf("Frame %d: lines hash %08x (%u lines), golden is %08x (%u lines)\n", frame,
+                   frameHash.linesHash, frameHash.numLines, goldenHash->linesHash,
+                   goldenHash->numLines);
+            return false;
+        }
+        if (!frameHash.SamplesMatch(*goldenHash)) {
+            Errorf("Frame %d: audio samples hash %08x (%u samples), golden is %08x (%u samples)\n",
+                   frame, frameHash.samplesHash, frameHash.numSamples, goldenHash->samplesHash,
+                   goldenHash->numSamples);
+            return false;
+        }
+        return true;
+    }
+
+} // namespace
+
+// Implement EngineClient free-standing functions: nothing to focus or overlay without a display
+void SetFocusMainWindow() {}
+
+void SetFocusConsole() {}
+
+void ResetOverlay(const char* /*file*/) {}
+
+void HeadlessEngine::RegisterClient(IEngineClient& client) {
+    g_client = &client;
+}
+
+void HeadlessEngine::RegisterReferenceClient(IEngineClient& client) {
+    g_referenceClient = &client;
+}
+
+bool HeadlessEngine::Run(int argc, char** argv) {
+    auto headlessOptions = ParseArgs(argc, argv);
+    if (!headlessOptions) {
+        PrintUsage(argv[0]);
+        return false;
+    }
+
+    // Unlike the GUI, prefer running from the current directory if it contains the bios, which is
+    // more convenient when scripting batch runs
+    if (!fs::exists("bios_rom.bin") &&
+        !FileSystemUtil::FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
+        return false;
+
+    FileStream linesStream, samplesStream;
+    if (headlessOptions->linesFile && !linesStream.Open(headlessOptions->linesFile->c_str(), "wb")) {
+        Errorf("Failed to open lines dump file: %s\n", headlessOptions->linesFile->c_str());
+        return false;
+    }
+    if (headlessOptions->samplesFile &&
+        !samplesStream.Open(headlessOptions->samplesFile->c_str(), "wb")) {
+        Errorf("Failed to open samples dump file: %s\n", headlessOptions->samplesFile->c_str());
+        return false;
+    }
+
+    // Paths are opened before the root path may change when initializing the client
+    FrameHashFile writeHashesFile, checkHashesFile;
+    if (headlessOptions->writeHashesFile &&
+        !writeHashesFile.OpenWrite(headlessOptions->writeHashesFile->c_str()))
+        return false;
+    if (headlessOptions->checkHashesFile &&
+        !checkHashesFile.OpenRead(headlessOptions->checkHashesFile->c_str()))
+        return false;
+    const bool hashFrames = headlessOptions->writeHashesFile || headlessOptions->checkHashesFile;
+    FrameHasher frameHasher;
+    bool hashesMatch = true;
+
+    // Client expects argv[0] to be the executable
+    std::vector<char*> clientArgv{argv[0]};
+    for (auto& arg : headlessOptions->clientArgs)
+        clientArgv.push_back(arg.data());
+
+    // Running Mine Storm instead of the requested rom would only produce misleading results
+    g_client->SetRomRequired(true);
+    if (!g_client->Init(static_cast<int>(clientArgv.size()), clientArgv.data())) {
+        return false;
+    }
+
+    IEngineClient* referenceClient = headlessOptions->compare ? g_referenceClient : nullptr;
+    if (headlessOptions->compare && !referenceClient) {
+        Errorf("No reference client registered to compare against\n");
+        return false;
+    }
+
+    if (referenceClient) {
+        auto referenceArgv = clientArgv;
+        for (auto& arg : headlessOptions->referenceArgs)
+            referenceArgv.push_back(arg.data());
+
+        referenceClient->SetRomRequired(true);
+        if (!referenceClient->Init(static_cast<int>(referenceArgv.size()), referenceArgv.data()))
+            return false;
+    }
+
+    // Options are only used to remember the last opened file, which never happens in headless
+    Options options;
+    options.Add<std::string>("lastOpenedFile", {});
+
+    RenderContext renderContext{};
+    AudioContext audioContext{CpuCyclesPerSec / AudioSampleRate};
+    RenderContext refRenderContext{};
+    AudioContext refAudioContext{CpuCyclesPerSec / AudioSampleRate};
+    bool framesMatch = true;
+
+    size_t totalLines = 0;
+    size_t totalSamples = 0;
+    int numFramesEmulated = 0;
+    uint64_t totalAllocations = 0;
+    int numAllocatingFrames = 0;
+    std::optional<int> lastAllocatingFrame;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (; numFramesEmulated < headlessOptions->numFrames; ++numFramesEmulated) {
+        const auto allocationsBefore = AllocationCounter::Count();
+
+        const Input input{};
+        auto emuEvents = EmuEvents{};
+        if (numFramesEmulated == 0 && headlessOptions->loadStateFile)
+            emuEvents.push_back({EmuEvent::LoadState{*headlessOptions->loadStateFile}});
+
+        if (!g_client->FrameUpdate(FrameTime, input, {std::ref(emuEvents), std::ref(options)},
+                                   renderContext, audioContext))
+            break;
+
+        if (referenceClient) {
+            // Both emulators must start from the same state
+            auto refEmuEvents = emuEvents;
+            if (!referenceClient->FrameUpdate(FrameTime, input,
+                                              {std::ref(refEmuEvents), std::ref(options)},
+                                              refRenderContext, refAudioContext))
+                break;
+
+            framesMatch = CompareFrames(numFramesEmulated, renderContext, audioContext,
+                                        refRenderContext, refAudioContext, *headlessOptions);
+            refRenderContext.lines.clear();
+            refAudioContext.samples.clear();
+            if (!framesMatch)
+                break;
+        }
+
+        if (hashFrames) {
+            const auto frameHash = frameHasher.Hash(renderContext, audioContext);
+            if (headlessOptions->writeHashesFile)
+                writeHashesFile.Write(frameHash);
+            if (headlessOptions->checkHashesFile) {
+                hashesMatch =
+                    CheckFrameHash(numFramesEmulated, frameHash, checkHashesFile.Read());
+                if (!hashesMatch)
+                    break;
+            }
+        }
+
+        if (linesStream.IsOpen())
+            DumpLines(linesStream, renderContext);
+        if (samplesStream.IsOpen())
+            DumpSamples(samplesStream, audioContext);
+
+        totalLines += renderContext.lines.size();
+        totalSamples += audioContext.samples.size();
+
+        renderContext.lines.clear();
+        audioContext.samples.clear();
+
+        if (const auto allocations = AllocationCounter::Count() - allocationsBefore;
+            allocations > 0) {
+            totalAllocations += allocations;
+            ++numAllocatingFrames;
+            lastAllocatingFrame = numFramesEmulated;
+        }
+    }
+
+    const std::chrono::duration<double> wallTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    if (headlessOptions->saveStateFile) {
+        // Zero frame time processes the event without emulating any further
+        auto emuEvents = EmuEvents{{EmuEvent::SaveState{*headlessOptions->saveStateFile}}};
+        g_client->FrameUpdate(0.0, {}, {std::ref(emuEvents), std::ref(options)}, renderContext,
+                              audioContext);
+    }
+
+    g_client->Shutdown();
+    if (referenceClient)
+        referenceClient->Shutdown();
+
+    const double emulatedTime = numFramesEmulated * FrameTime;
+    Printf("Emulated %d frames (%.2f s) in %.3f s: %.2f emulated seconds per wall second\n",
+           numFramesEmulated, emulatedTime, wallTime.count(), emulatedTime / wallTime.count());
+    Printf("Produced %zu lines and %zu audio samples\n", totalLines, totalSamples);
+    Printf("Made %llu heap allocations over %d frames", (unsigned long long)totalAllocations,
+           numAllocatingFrames);
+    if (lastAllocatingFrame)
+        Printf(", the last one in frame %d", *lastAllocatingFrame);
+    Printf("\n");
+
+    if (referenceClient && framesMatch)
+        Printf("All frames match the reference\n");
+    if (headlessOptions->checkHashesFile && hashesMatch)
+        Printf("All frames match the golden hashes\n");
+
+    return framesMatch && hashesMatch;
+}
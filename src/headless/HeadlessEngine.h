@@ -0,0 +1,18 @@
+#pragma once
+
+#include "EngineClient.h"
+
+// Display-less engine that drives the client as fast as possible, without SDL, OpenGL or ImGui.
+// Meant for batch throughput runs: reports emulated seconds per wall-clock second, and optionally
+// dumps the lines and audio samples produced each frame.
+class HeadlessEngine {
+public:
+    void RegisterClient(IEngineClient& client);
+
+    // Only used with -compare: run alongside the client, with the same input, as the reference to
+    // compare the client's output against
+    void RegisterReferenceClient(IEngineClient& client);
+
+    // Blocking call, returns once the requested number of frames has been emulated
+    bool Run(int argc, char** argv);
+};
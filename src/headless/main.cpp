@@ -0,0 +1,13 @@
+#include "HeadlessEngine.h"
+#include "Vectrexy.h"
+#include <memory>
+
+int main(int argc, char** argv) {
+    auto client = std::make_unique<Vectrexy>();
+    auto referenceClient = std::make_unique<Vectrexy>();
+    auto engine = std::make_unique<HeadlessEngine>();
+    engine->RegisterClient(*client);
+    engine->RegisterReferenceClient(*referenceClient);
+    bool result = engine->Run(argc, argv);
+    return result ? 0 : -1;
+}
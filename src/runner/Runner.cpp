@@ -0,0 +1,309 @@
+#include "ConsoleOutput.h"
+#include "EngineClient.h"
+#include "FileSystem.h"
+#include "FileSystemUtil.h"
+#include "FrameHash.h"
+#include "InstructionHasher.h"
+#include "Options.h"
+#include "StringHelpers.h"
+#include "Vectrexy.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs every rom of a library through a fixed number of frames, each in its own emulator instance,
+// with one task per rom on a work-stealing thread pool. Prints a checksum of each rom's frame
+// hashes, which can be compared against those of a previous run, and the aggregate throughput.
+
+namespace {
+    // Same as the headless engine
+    const double FrameTime = 1.0 / 60.0;
+    const float CpuCyclesPerSec = 1'500'000;
+    const int AudioSampleRate = 44100;
+
+    // Emulator options followed by a value that's passed on as is, or that's an input path
+    const std::array<const char*, 2> ClientValueOptions = {"-hashmode", "-hashgranularity"};
+    const std::array<const char*, 1> ClientPathOptions = {"-playmovie"};
+    // Emulator options that write a file, which every instance would write at once
+    const std::array<const char*, 4> ClientOutputOptions = {"-recordmovie", "-tracefile",
+                                                            "-profileops", "-profilehotspots"};
+
+    template <typename Container>
+    bool IsOneOf(const std::string& arg, const Container& names) {
+        return std::find(names.begin(), names.end(), arg) != names.end();
+    }
+
+    struct Rom {
+        std::string name; // As passed on the command line, or found in a directory passed
+        std::string path; // Absolute, as the root path gets changed to where the bios is
+    };
+
+    struct RunnerOptions {
+        int numFrames = 60 * 60;
+        size_t numJobs = std::max(std::thread::hardware_concurrency(), 1u);
+        unsigned int seed = 0;
+        std::optional<std::string> resultsFile;
+        std::optional<std::string> expectFile;
+        std::vector<Rom> roms;
+        std::vector<std::string> clientArgs;
+    };
+
+    struct RomResult {
+        bool initialized = false;
+        int frames = 0;
+        double seconds = 0;
+        size_t lines = 0;
+        size_t samples = 0;
+        uint32_t checksum{}; // CRC32C of every frame's FrameHash
+    };
+
+    void PrintUsage(const char* exeName) {
+        Printf("Usage: %s [options] <rom or directory>...\n", exeName);
+        Printf("Options:\n");
+        Printf("  -frames <n>          Number of frames to emulate per rom (default: 3600)\n");
+        Printf("  -jobs <n>            Number of worker threads (default: number of cores)\n");
+        Printf("  -seed <n>            Seed of the initial random RAM contents (default: 0)\n");
+        Printf("  -results <file>      Write each rom's checksum to file\n");
+        Printf("  -expect <file>       Compare each rom's checksum against a results file\n");
+        Printf("Directories are searched recursively for .vec and .bin roms. Any other argument\n"
+               "is passed on to every emulator (e.g. -blocks), except for options that write a\n"
+               "file (-recordmovie, -tracefile, -profileops, -profilehotspots)\n");
+    }
+
+    void AddRoms(const std::string& arg, std::vector<Rom>& roms) {
+        if (!fs::is_directory(arg)) {
+            roms.push_back({arg, fs::absolute(arg).string()});
+            return;
+        }
+
+        std::vector<std::string> dirRoms;
+        for (auto& entry : fs::recursive_directory_iterator(arg)) {
+            const auto& path = entry.path();
+            const auto extension = ToLower(path.extension().string());
+            if (fs::is_regular_file(path) && (extension == ".vec" || extension == ".bin") &&
+                path.filename() != "bios_rom.bin") {
+                dirRoms.push_back(path.string());
+            }
+        }
+        std::sort(dirRoms.begin(), dirRoms.end());
+        for (auto& rom : dirRoms)
+            roms.push_back({rom, fs::absolute(rom).string()});
+    }
+
+    std::optional<RunnerOptions> ParseArgs(int argc, char** argv) {
+        RunnerOptions options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "-frames" && hasValue) {
+                options.numFrames = std::stoi(argv[++i]);
+            } else if (arg == "-jobs" && hasValue) {
+                options.numJobs = std::stoul(argv[++i]);
+            } else if (arg == "-seed" && hasValue) {
+                options.seed = static_cast<unsigned int>(std::stoul(argv[++i]));
+            } else if (arg == "-results" && hasValue) {
+                options.resultsFile = fs::absolute(argv[++i]).string();
+            } else if (arg == "-expect" && hasValue) {
+                options.expectFile = fs::absolute(argv[++i]).string();
+            } else if (arg == "-h" || arg == "-help") {
+                return {};
+            } else if (IsOneOf(arg, ClientOutputOptions)) {
+                Errorf("%s is not supported, as every rom would write the same file\n",
+                       arg.c_str());
+                return {};
+            } else if (IsOneOf(arg, ClientPathOptions) && hasValue) {
+                options.clientArgs.push_back(arg);
+                options.clientArgs.push_back(fs::absolute(argv[++i]).string());
+            } else if (IsOneOf(arg, ClientValueOptions) && hasValue) {
+                options.clientArgs.push_back(arg);
+                options.clientArgs.push_back(argv[++i]);
+            } else if (!arg.empty() && arg[0] != '-') {
+                AddRoms(arg, options.roms);
+            } else {
+                options.clientArgs.push_back(arg);
+            }
+        }
+
+        if (options.roms.empty())
+            return {};
+        return options;
+    }
+
+    // Emulator initialization sets up process-wide state, such as the console's ctrl handler and
+    // buffering, so instances are initialized and shut down one at a time
+    std::mutex g_initMutex;
+
+    RomResult RunRom(const Rom& rom, const RunnerOptions& runnerOptions) {
+        RomResult result;
+
+        std::vector<std::string> args{"vectrexy", rom.path, "-notrace", "-seed",
+                                      std::to_string(runnerOptions.seed)};
+        args.insert(args.end(), runnerOptions.clientArgs.begin(), runnerOptions.clientArgs.end());
+        std::vector<char*> argv;
+        for (auto& arg : args)
+            argv.push_back(arg.data());
+
+        std::unique_ptr<IEngineClient> emulator = std::make_unique<Vectrexy>();
+        emulator->SetRomRequired(true);
+        {
+            std::lock_guard<std::mutex> lock(g_initMutex);
+            result.initialized = emulator->Init(static_cast<int>(argv.size()), argv.data());
+        }
+        if (!result.initialized)
+            return result;
+
+        // Options are only used to remember the last opened file, which never happens here
+        Options options;
+        options.Add<std::string>("lastOpenedFile", {});
+
+        FrameHasher frameHasher;
+        RenderContext renderContext{};
+        AudioContext audioContext{CpuCyclesPerSec / AudioSampleRate};
+
+        const auto startTime = std::chrono::high_resolution_clock::now();
+        for (; result.frames < runnerOptions.numFrames; ++result.frames) {
+            auto emuEvents = EmuEvents{};
+            if (!emulator->FrameUpdate(FrameTime, {}, {std::ref(emuEvents), std::ref(options)},
+                                       renderContext, audioContext))
+                break;
+
+            const auto frameHash = frameHasher.Hash(renderContext, audioContext);
+            result.checksum = Crc32c(result.checksum, &frameHash, sizeof(frameHash));
+            result.lines += renderContext.lines.size();
+            result.samples += audioContext.samples.size();
+
+            renderContext.lines.clear();
+            audioContext.samples.clear();
+        }
+        const std::chrono::duration<double> elapsed =
+            std::chrono::high_resolution_clock::now() - startTime;
+        result.seconds = elapsed.count();
+
+        std::lock_guard<std::mutex> lock(g_initMutex);
+        emulator->Shutdown();
+        return result;
+    }
+
+    // Results file format, per line: checksum in hex, then the rom as passed on the command line
+    std::map<std::string, uint32_t> ReadResultsFile(const std::string& file) {
+        std::map<std::string, uint32_t> checksums;
+        std::ifstream fin(file);
+        std::string line;
+        while (std::getline(fin, line)) {
+            const auto separator = line.find(' ');
+            if (separator == std::string::npos)
+                continue;
+            checksums[line.substr(separator + 1)] =
+                HexStringToIntegral<uint32_t>(line.substr(0, separator).c_str());
+        }
+        return checksums;
+    }
+
+} // namespace
+
+// Implement EngineClient free-standing functions: nothing to focus or overlay without a display
+void SetFocusMainWindow() {}
+
+void SetFocusConsole() {}
+
+void ResetOverlay(const char* /*file*/) {}
+
+int main(int argc, char** argv) {
+    auto options = ParseArgs(argc, argv);
+    if (!options) {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+
+    if (!fs::exists("bios_rom.bin") &&
+        !FileSystemUtil::FindAndSetRootPath(fs::path(fs::absolute(argv[0]))))
+        return -1;
+
+    std::map<std::string, uint32_t> expectedChecksums;
+    if (options->expectFile) {
+        if (!fs::exists(*options->expectFile)) {
+            Errorf("Failed to open results file: %s\n", options->expectFile->c_str());
+            return -1;
+        }
+        expectedChecksums = ReadResultsFile(*options->expectFile);
+    }
+
+    std::vector<RomResult> results(options->roms.size());
+    size_t numStolen = 0;
+
+    const auto startTime = std::chrono::high_resolution_clock::now();
+    {
+        WorkStealingPool pool(options->numJobs);
+        for (size_t i = 0; i < options->roms.size(); ++i) {
+            pool.Submit([&, i] { results[i] = RunRom(options->roms[i], *options); });
+        }
+        pool.Wait();
+        numStolen = pool.NumStolen();
+    }
+    const std::chrono::duration<double> wallTime =
+        std::chrono::high_resolution_clock::now() - startTime;
+
+    std::ofstream resultsStream;
+    if (options->resultsFile) {
+        resultsStream.open(*options->resultsFile);
+        if (!resultsStream)
+            Errorf("Failed to create results file: %s\n", options->resultsFile->c_str());
+    }
+
+    int numFailed = 0;
+    int totalFrames = 0;
+    for (size_t i = 0; i < options->roms.size(); ++i) {
+        const auto& rom = options->roms[i].name;
+        const auto& result = results[i];
+        if (!result.initialized) {
+            Errorf("FAILED   %s: failed to initialize\n", rom.c_str());
+            ++numFailed;
+            continue;
+        }
+
+        const char* status = "";
+        if (result.frames < options->numFrames) {
+            // The emulator stopped (e.g. the rom halted), which no checksum should pass for
+            status = " STOPPED EARLY";
+            ++numFailed;
+        } else if (options->expectFile) {
+            auto iter = expectedChecksums.find(rom);
+            if (iter == expectedChecksums.end()) {
+                status = " (no expected checksum)";
+            } else if (iter->second != result.checksum) {
+                status = " MISMATCH";
+                ++numFailed;
+            }
+        }
+
+        Printf("%08x %s: %d frames, %zu lines, %zu samples in %.2f s%s\n", result.checksum,
+               rom.c_str(), result.frames, result.lines, result.samples, result.seconds, status);
+        if (resultsStream)
+            resultsStream << FormattedString<>("%08x ", result.checksum).Value() << rom << "\n";
+
+        totalFrames += result.frames;
+    }
+
+    const double emulatedTime = totalFrames * FrameTime;
+    Printf("Emulated %zu roms, %d frames (%.2f s) in %.3f s on %zu threads: %.2f emulated seconds "
+           "per wall second, %zu tasks stolen\n",
+           options->roms.size(), totalFrames, emulatedTime, wallTime.count(), options->numJobs,
+           emulatedTime / wallTime.count(), numStolen);
+
+    if (numFailed > 0) {
+        Errorf("%d roms failed or didn't match\n", numFailed);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs tasks on a fixed set of worker threads. Each worker has its own queue of tasks: it takes
+// from the back of its own, and once empty, steals from the front of the other workers' queues, so
+// that all workers stay busy until the end even when tasks take very different amounts of time.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(size_t numWorkers) {
+        for (size_t i = 0; i < std::max<size_t>(numWorkers, 1); ++i)
+            m_workers.push_back(std::make_unique<Worker>());
+        for (size_t i = 0; i < m_workers.size(); ++i)
+            m_threads.emplace_back([this, i] { WorkerThread(i); });
+    }
+
+    // Waits for all submitted tasks to be done
+    ~WorkStealingPool() {
+        Wait();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_workAvailable.notify_all();
+        for (auto& thread : m_threads)
+            thread.join();
+    }
+
+    size_t NumWorkers() const { return m_workers.size(); }
+
+    // Tasks are spread over the workers' queues in turn
+    void Submit(Task task) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& worker = *m_workers[m_nextWorker++ % m_workers.size()];
+            {
+                std::lock_guard<std::mutex> workerLock(worker.mutex);
+                worker.tasks.push_back(std::move(task));
+            }
+            ++m_numQueued;
+            ++m_numPending;
+        }
+        m_workAvailable.notify_one();
+    }
+
+    // Blocks until every submitted task has run
+    void Wait() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_allDone.wait(lock, [this] { return m_numPending == 0; });
+    }
+
+    // Tasks run by another worker than the one they were submitted to
+    size_t NumStolen() const { return m_numStolen; }
+
+private:
+    struct Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool TryPop(size_t workerIndex, Task& task) {
+        for (size_t i = 0; i < m_workers.size(); ++i) {
+            auto& worker = *m_workers[(workerIndex + i) % m_workers.size()];
+            std::lock_guard<std::mutex> workerLock(worker.mutex);
+            if (worker.tasks.empty())
+                continue;
+            if (i == 0) {
+                task = std::move(worker.tasks.back());
+                worker.tasks.pop_back();
+            } else {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                ++m_numStolen;
+            }
+            return true;
+        }
+        return false;
+    }
+
+    void WorkerThread(size_t workerIndex) {
+        while (true) {
+            Task task;
+            if (TryPop(workerIndex, task)) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    --m_numQueued;
+                }
+                task();
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_numPending == 0)
+                    m_allDone.notify_all();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [this] { return m_quit || m_numQueued > 0; });
+            if (m_quit)
+                return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex; // Guards everything below
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_allDone;
+    size_t m_nextWorker = 0;
+    size_t m_numQueued = 0;  // Submitted and not yet taken by a worker
+    size_t m_numPending = 0; // Submitted and not yet done
+    bool m_quit = false;
+
+    std::atomic<size_t> m_numStolen{};
+};
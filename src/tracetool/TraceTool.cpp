@@ -0,0 +1,143 @@
+#include "BiosSymbols.h"
+#include "ConsoleOutput.h"
+#include "InstructionTrace.h"
+#include "Platform.h"
+#include "StringHelpers.h"
+#include "TraceFile.h"
+#include <cstring>
+#include <optional>
+#include <string>
+
+// Disassembles and filters binary trace files written by the debugger's "stream" command, or the
+// emulator's -tracefile option, in the same format as the debugger's trace output.
+
+namespace {
+    struct TraceToolOptions {
+        std::string traceFile;
+        std::vector<std::string> symbolFiles;
+        uint64_t start = 0;
+        std::optional<uint64_t> count;
+        std::optional<std::pair<uint16_t, uint16_t>> pcRange;
+        std::optional<std::string> opName;
+        std::optional<uint16_t> memoryAddress;
+        bool printIndex = false;
+        bool color = false;
+    };
+
+    void PrintUsage(const char* exeName) {
+        Printf("Usage: %s [options] <trace_file>\n", exeName);
+        Printf("Options:\n");
+        Printf("  -symbols <file>      Load symbol definitions (BIOS symbols are always known)\n");
+        Printf("  -start <n>           Skip the first n instructions\n");
+        Printf("  -count <n>           Print at most n instructions\n");
+        Printf("  -pc <addr>[:<addr>]  Only instructions at address, or in inclusive range\n");
+        Printf("  -op <name>           Only instructions with mnemonic name (e.g. JSR)\n");
+        Printf("  -mem <addr>          Only instructions that read or write address\n");
+        Printf("  -index               Prefix each instruction with its index in the trace\n");
+        Printf("  -color               Colored output\n");
+    }
+
+    std::optional<TraceToolOptions> ParseArgs(int argc, char** argv) {
+        TraceToolOptions options;
+
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "-symbols" && hasValue) {
+                options.symbolFiles.push_back(argv[++i]);
+            } else if (arg == "-start" && hasValue) {
+                options.start = StringToIntegral<uint64_t>(argv[++i]);
+            } else if (arg == "-count" && hasValue) {
+                options.count = StringToIntegral<uint64_t>(argv[++i]);
+            } else if (arg == "-pc" && hasValue) {
+                auto range = Split(argv[++i], ":");
+                if (range.empty())
+                    return {};
+                options.pcRange = {StringToIntegral<uint16_t>(range.front()),
+                                   StringToIntegral<uint16_t>(range.back())};
+            } else if (arg == "-op" && hasValue) {
+                options.opName = ToLower(argv[++i]);
+            } else if (arg == "-mem" && hasValue) {
+                options.memoryAddress = StringToIntegral<uint16_t>(argv[++i]);
+            } else if (arg == "-index") {
+                options.printIndex = true;
+            } else if (arg == "-color") {
+                options.color = true;
+            } else if (arg[0] != '-' && options.traceFile.empty()) {
+                options.traceFile = arg;
+            } else {
+                return {};
+            }
+        }
+
+        if (options.traceFile.empty())
+            return {};
+        return options;
+    }
+
+    bool Matches(const InstructionTraceInfo& traceInfo, const TraceToolOptions& options) {
+        const uint16_t pc = traceInfo.preOpCpuRegisters.PC;
+        if (options.pcRange && (pc < options.pcRange->first || pc > options.pcRange->second))
+            return false;
+
+        if (options.opName && ToLower(traceInfo.instruction.cpuOp->name) != *options.opName)
+            return false;
+
+        if (options.memoryAddress) {
+            for (size_t i = 0; i < traceInfo.numMemoryAccesses; ++i) {
+                if (traceInfo.memoryAccesses[i].address == *options.memoryAddress)
+                    return true;
+            }
+            return false;
+        }
+        return true;
+    }
+} // namespace
+
+int main(int argc, char** argv) {
+    auto options = ParseArgs(argc, argv);
+    if (!options) {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+
+    Debugger::SymbolTable symbolTable;
+    for (auto& [address, name] : BiosSymbols)
+        symbolTable.insert({address, name});
+    for (auto& file : options->symbolFiles) {
+        if (!LoadUserSymbolsFile(file.c_str(), symbolTable)) {
+            Errorf("Failed to load symbols file: %s\n", file.c_str());
+            return -1;
+        }
+    }
+
+    TraceFileReader reader;
+    if (!reader.Open(options->traceFile.c_str())) {
+        Errorf("Failed to open trace file, or not a trace file: %s\n",
+               options->traceFile.c_str());
+        return -1;
+    }
+
+    Platform::SetConsoleColoringEnabled(options->color);
+
+    InstructionTraceInfo traceInfo;
+    uint64_t numPrinted = 0;
+    for (uint64_t index = 0; reader.Read(traceInfo); ++index) {
+        if (options->count && numPrinted >= *options->count)
+            break;
+        if (index < options->start || !Matches(traceInfo, *options))
+            continue;
+
+        if (options->printIndex)
+            Printf("%10llu ", (unsigned long long)index);
+        PrintOp(traceInfo, symbolTable);
+        ++numPrinted;
+    }
+
+    if (reader.Corrupt()) {
+        Errorf("Trace file is truncated or corrupt\n");
+        return -1;
+    }
+    return 0;
+}